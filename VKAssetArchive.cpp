@@ -0,0 +1,222 @@
+#include "VKAssetArchive.h"
+#include "VKCompression.h"
+
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+// the index is copied straight from the file
+static_assert(sizeof(VKAssetArchive::Entry) == 48, "Archive entry layout changed!");
+
+namespace {
+	uint64_t alignUp(uint64_t value) {
+		return (value + VKAssetArchive::Alignment - 1) / VKAssetArchive::Alignment * VKAssetArchive::Alignment;
+	}
+}
+
+bool VKAssetArchive::tryOpen(const std::string& pathIn) {
+	close();
+	if (!file.tryOpen(pathIn)) {
+		return false;
+	}
+	path = pathIn;
+	std::error_code error;
+	writeTime = std::filesystem::last_write_time(path, error);
+
+	auto invalid = [this, pathIn]() {
+		close();
+		return std::runtime_error("Invalid asset archive " + pathIn + "!");
+	};
+
+	const size_t size = file.size();
+	Header header;
+	if (size < sizeof(header)) {
+		throw invalid();
+	}
+	memcpy(&header, file.data(), sizeof(header));
+	size_t namesStart = sizeof(Header) + size_t(header.entryCount) * sizeof(Entry);
+	if (memcmp(header.magic, "VKPK", 4) != 0 || header.version != Version || namesStart + header.namesSize > size) {
+		throw invalid();
+	}
+
+	entries.resize(header.entryCount);
+	memcpy(entries.data(), file.data() + sizeof(Header), entries.size() * sizeof(Entry));
+	names = file.data() + namesStart;
+
+	for (const Entry& entry : entries) {
+		bool valid = entry.offset % Alignment == 0 && entry.offset <= size && entry.storedSize <= size - entry.offset
+			&& uint64_t(entry.nameOffset) + entry.nameLength <= header.namesSize
+			&& (entry.compression == Compression::LZ4 || (entry.compression == Compression::None && entry.storedSize == entry.size));
+		if (!valid) {
+			throw invalid();
+		}
+	}
+	return true;
+}
+
+void VKAssetArchive::close() {
+	file.close();
+	entries.clear();
+	names = nullptr;
+	path.clear();
+
+	std::lock_guard<std::mutex> lock(reportedMutex);
+	reportedNewer.clear();
+}
+
+std::string VKAssetArchive::getName(const Entry& entry) const {
+	return std::string(names + entry.nameOffset, entry.nameLength);
+}
+
+const VKAssetArchive::Entry* VKAssetArchive::find(const std::string& name) const {
+	uint64_t hash = hashName(name);
+	auto it = std::lower_bound(entries.begin(), entries.end(), hash, [](const Entry& entry, uint64_t value) {
+		return entry.hash < value;
+	});
+	for (; it != entries.end() && it->hash == hash; ++it) {
+		if (it->nameLength == name.size() && memcmp(names + it->nameOffset, name.data(), name.size()) == 0) {
+			return &*it;
+		}
+	}
+	return nullptr;
+}
+
+const VKAssetArchive::Entry* VKAssetArchive::findCurrent(const std::string& name) const {
+	const Entry* entry = find(name);
+	if (entry == nullptr) {
+		return nullptr;
+	}
+
+	std::error_code error;
+	std::filesystem::file_time_type looseTime = std::filesystem::last_write_time(name, error);
+	if (error || looseTime <= writeTime) {
+		return entry;
+	}
+
+	std::lock_guard<std::mutex> lock(reportedMutex);
+	if (reportedNewer.insert(name).second) {
+		std::cout << name << " is newer than " << path << ", loading the loose file" << std::endl;
+	}
+	return nullptr;
+}
+
+VKAssetData VKAssetArchive::load(const Entry& entry) const {
+	VKAssetData result;
+	result.size = static_cast<size_t>(entry.size);
+	if (entry.compression == Compression::None) {
+		// the payload is padded with zeros to the next 4K, which covers the word padding
+		result.data = file.data() + entry.offset;
+		return result;
+	}
+
+	result.storage.resize(result.getPaddedSize());
+	unpack(entry, file.data() + entry.offset, result.storage.data());
+	result.data = result.storage.data();
+	return result;
+}
+
+void VKAssetArchive::read(VKAsyncIO& io, const Entry& entry, VKAsyncIO::DecodeFunc decode) const {
+	io.read(path, static_cast<size_t>(entry.offset), static_cast<size_t>(entry.storedSize), [entry, decode](const char* data, size_t) {
+		if (entry.compression == Compression::None) {
+			decode(data, static_cast<size_t>(entry.size));
+			return;
+		}
+		std::vector<char> unpacked(static_cast<size_t>(entry.size));
+		unpack(entry, data, unpacked.data());
+		decode(unpacked.data(), unpacked.size());
+	});
+}
+
+void VKAssetArchive::write(const std::string& path, const std::vector<Source>& sources) {
+	std::vector<Entry> entries(sources.size());
+	std::vector<std::vector<char>> payloads(sources.size());
+	std::string names;
+
+	for (size_t i = 0; i < sources.size(); i++) {
+		const Source& source = sources[i];
+		Entry& entry = entries[i];
+		entry = {};
+		entry.hash = hashName(source.name);
+		entry.nameOffset = static_cast<uint32_t>(names.size());
+		entry.nameLength = static_cast<uint32_t>(source.name.size());
+		entry.size = source.data.size();
+		names += source.name;
+
+		// already compressed formats like jpg don't shrink, those stay as they are
+		std::vector<char> compressed = VKCompression::compress(source.data.data(), source.data.size());
+		if (compressed.size() < source.data.size() - source.data.size() / 8) {
+			entry.compression = Compression::LZ4;
+			payloads[i] = std::move(compressed);
+		}
+		else {
+			entry.compression = Compression::None;
+			payloads[i] = source.data;
+		}
+		entry.storedSize = payloads[i].size();
+	}
+
+	std::vector<size_t> order(sources.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return entries[a].hash != entries[b].hash ? entries[a].hash < entries[b].hash : sources[a].name < sources[b].name;
+	});
+	for (size_t i = 1; i < order.size(); i++) {
+		if (sources[order[i]].name == sources[order[i - 1]].name) {
+			throw std::runtime_error("Asset " + sources[order[i]].name + " added twice!");
+		}
+	}
+
+	// payloads keep the order they were given in, so assets used together stay next to each other
+	uint64_t offset = alignUp(sizeof(Header) + entries.size() * sizeof(Entry) + names.size());
+	for (Entry& entry : entries) {
+		entry.offset = offset;
+		offset = alignUp(offset + entry.storedSize);
+	}
+
+	Header header = {};
+	memcpy(header.magic, "VKPK", 4);
+	header.version = Version;
+	header.entryCount = static_cast<uint32_t>(entries.size());
+	header.namesSize = static_cast<uint32_t>(names.size());
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out.is_open()) {
+		throw std::runtime_error("Failed to open " + path + "!");
+	}
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	for (size_t index : order) {
+		out.write(reinterpret_cast<const char*>(&entries[index]), sizeof(Entry));
+	}
+	out.write(names.data(), names.size());
+
+	const std::vector<char> zeros(Alignment, 0);
+	for (size_t i = 0; i < entries.size(); i++) {
+		uint64_t position = static_cast<uint64_t>(out.tellp());
+		out.write(zeros.data(), static_cast<std::streamsize>(entries[i].offset - position));
+		out.write(payloads[i].data(), payloads[i].size());
+	}
+	uint64_t position = static_cast<uint64_t>(out.tellp());
+	out.write(zeros.data(), static_cast<std::streamsize>(alignUp(position) - position));
+
+	if (!out) {
+		throw std::runtime_error("Failed to write " + path + "!");
+	}
+}
+
+uint64_t VKAssetArchive::hashName(const std::string& name) {
+	// FNV-1a, part of the format so it must never change
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : name) {
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+void VKAssetArchive::unpack(const Entry& entry, const char* data, char* output) {
+	VKCompression::decompress(data, static_cast<size_t>(entry.storedSize), output, static_cast<size_t>(entry.size));
+}
\ No newline at end of file
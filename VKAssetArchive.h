@@ -0,0 +1,96 @@
+#pragma once
+
+#include "VKMappedFile.h"
+#include "VKAsyncIO.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+#include <unordered_set>
+#include <mutex>
+
+// bytes of one asset, either a copy of a loose file or an archive entry, followed by zeros up to
+// a multiple of 4 so shader code can be used as words
+struct VKAssetData {
+	const char* data = nullptr;
+	size_t size = 0;
+	std::vector<char> storage;
+
+	size_t getPaddedSize() const { return (size + 3) / 4 * 4; }
+};
+
+// Packed read-only asset archive. A header and an index sorted by name hash sit at the front, so
+// lookups are a binary search, and every payload starts on a 4K boundary so it can be read with
+// one aligned request. Payloads are stored LZ4 compressed when that makes them meaningfully smaller.
+//
+// Layout: Header, Entry[entryCount], names, zero padding to 4K, then the payloads, each padded
+// with zeros to the next 4K.
+class VKAssetArchive
+{
+public:
+	static const uint32_t Alignment = 4096;
+
+	enum class Compression : uint32_t {
+		None,
+		LZ4
+	};
+
+	struct Entry {
+		uint64_t hash;
+		uint64_t offset;
+		uint64_t storedSize;
+		uint64_t size;
+		uint32_t nameOffset;
+		uint32_t nameLength;
+		Compression compression;
+		uint32_t reserved;
+	};
+
+	struct Source {
+		std::string name;
+		std::vector<char> data;
+	};
+
+	// throws if the file exists but isn't a valid archive
+	bool tryOpen(const std::string& path);
+	void close();
+	bool isOpen() const { return file.isOpen(); }
+	const std::string& getPath() const { return path; }
+	const std::vector<Entry>& getEntries() const { return entries; }
+	std::string getName(const Entry& entry) const;
+
+	const Entry* find(const std::string& name) const;
+	// like find, but null when a loose file of that name was written after the archive, so a stale
+	// pack doesn't hide edits; each such file is reported once
+	const Entry* findCurrent(const std::string& name) const;
+	// uncompressed entries point into the archive mapping, compressed ones are unpacked
+	VKAssetData load(const Entry& entry) const;
+	// reads the entry through io and unpacks it on the worker before handing it to decode
+	void read(VKAsyncIO& io, const Entry& entry, VKAsyncIO::DecodeFunc decode) const;
+
+	static void write(const std::string& path, const std::vector<Source>& sources);
+	static uint64_t hashName(const std::string& name);
+
+private:
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t namesSize;
+	};
+
+	static const uint32_t Version = 1;
+
+	static void unpack(const Entry& entry, const char* data, char* output);
+
+	std::string path;
+	VKMappedFile file;
+	std::filesystem::file_time_type writeTime;
+	std::vector<Entry> entries;
+	const char* names = nullptr;
+
+	// findCurrent runs on loader and pipeline worker threads
+	mutable std::mutex reportedMutex;
+	mutable std::unordered_set<std::string> reportedNewer;
+};
\ No newline at end of file
@@ -0,0 +1,185 @@
+#include "VKAssetCache.h"
+#include "VKCompression.h"
+#include "VKMappedFile.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+	// a temporary file this old belongs to a store that never finished
+	const auto AbandonedTemporaryAge = std::chrono::hours(1);
+
+	uint64_t getProcessId() {
+#ifdef _WIN32
+		return static_cast<uint64_t>(_getpid());
+#else
+		return static_cast<uint64_t>(getpid());
+#endif
+	}
+}
+
+void VKAssetCache::create(const std::string& directoryIn, uint64_t maxSize) {
+	std::error_code error;
+	std::filesystem::create_directories(directoryIn, error);
+	if (error) {
+		std::cerr << "Asset cache " << directoryIn << " unavailable: " << error.message() << std::endl;
+		directory.clear();
+		return;
+	}
+	directory = directoryIn;
+	evict(maxSize);
+}
+
+bool VKAssetCache::load(const std::string& kind, uint64_t key, std::vector<char>& data) const {
+	if (!isEnabled()) {
+		return false;
+	}
+
+	VKMappedFile file;
+	Header header;
+	bool valid = file.tryOpen(getPath(kind, key)) && file.size() >= sizeof(header);
+	if (valid) {
+		memcpy(&header, file.data(), sizeof(header));
+		valid = memcmp(header.magic, "VKAC", 4) == 0 && header.version == Version && header.key == key
+			&& header.storedSize == file.size() - sizeof(header);
+	}
+	if (valid) {
+		try {
+			data.resize(static_cast<size_t>(header.size));
+			VKCompression::decompress(file.data() + sizeof(header), static_cast<size_t>(header.storedSize), data.data(), data.size());
+			valid = hash(data.data(), data.size()) == header.checksum;
+		}
+		catch (const std::exception&) {
+			valid = false;
+		}
+	}
+
+	if (valid) {
+		// what eviction goes by
+		std::error_code error;
+		std::filesystem::last_write_time(getPath(kind, key), std::filesystem::file_time_type::clock::now(), error);
+	}
+
+	(valid ? hits : misses)++;
+	return valid;
+}
+
+void VKAssetCache::store(const std::string& kind, uint64_t key, const std::vector<char>& data) const {
+	if (!isEnabled()) {
+		return;
+	}
+
+	std::vector<char> compressed = VKCompression::compress(data.data(), data.size());
+
+	Header header = {};
+	memcpy(header.magic, "VKAC", 4);
+	header.version = Version;
+	header.key = key;
+	header.size = data.size();
+	header.storedSize = compressed.size();
+	header.checksum = hash(data.data(), data.size());
+
+	// unique per process and thread, so concurrent stores of the same entry don't write into each other
+	std::string path = getPath(kind, key);
+	std::string temporaryPath = path + "." + std::to_string(getProcessId()) + "-"
+		+ std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+	{
+		std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(compressed.data(), compressed.size());
+		if (!out) {
+			std::cerr << "Failed to write asset cache entry " << path << std::endl;
+			out.close();
+			std::remove(temporaryPath.c_str());
+			return;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error) {
+		std::remove(temporaryPath.c_str());
+	}
+}
+
+void VKAssetCache::evict(uint64_t maxSize) const {
+	struct CachedFile {
+		std::filesystem::path path;
+		std::filesystem::file_time_type writeTime;
+		uint64_t size;
+	};
+
+	std::vector<CachedFile> files;
+	uint64_t totalSize = 0;
+	auto now = std::filesystem::file_time_type::clock::now();
+
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+		std::error_code entryError;
+		if (!entry.is_regular_file(entryError)) {
+			continue;
+		}
+		std::filesystem::file_time_type writeTime = entry.last_write_time(entryError);
+		uint64_t size = entry.file_size(entryError);
+		if (entryError) {
+			continue;
+		}
+
+		if (entry.path().extension() == ".tmp") {
+			if (now - writeTime > AbandonedTemporaryAge) {
+				std::filesystem::remove(entry.path(), entryError);
+			}
+			continue;
+		}
+		files.push_back({ entry.path(), writeTime, size });
+		totalSize += size;
+	}
+
+	if (totalSize <= maxSize) {
+		return;
+	}
+
+	std::sort(files.begin(), files.end(), [](const CachedFile& a, const CachedFile& b) {
+		return a.writeTime < b.writeTime;
+	});
+
+	size_t evicted = 0;
+	for (const CachedFile& file : files) {
+		if (totalSize <= maxSize) {
+			break;
+		}
+		std::error_code removeError;
+		if (std::filesystem::remove(file.path, removeError)) {
+			totalSize -= file.size;
+			evicted++;
+		}
+	}
+	std::cout << "Asset cache: evicted " << evicted << " entries, " << totalSize / (1024 * 1024) << " MB left" << std::endl;
+}
+
+uint64_t VKAssetCache::hash(const void* data, size_t size, uint64_t hash) {
+	// FNV-1a
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+std::string VKAssetCache::getPath(const std::string& kind, uint64_t key) const {
+	char name[17];
+	snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+	return directory + "/" + kind + "-" + name + ".bin";
+}
\ No newline at end of file
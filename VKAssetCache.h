@@ -0,0 +1,107 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+// Derived asset data kept on disk between runs. An entry is keyed by a hash of its source bytes
+// and of every parameter that affects the processing, so an unchanged asset is never processed
+// twice and an edited one simply misses and gets rebuilt. Entries are LZ4 compressed and written
+// through a temporary file and a rename, so a crash or a second instance never leaves half an entry.
+// A hit refreshes the entry's write time, and create drops the least recently used entries once the
+// directory outgrows maxSize. Safe to use from several threads.
+class VKAssetCache
+{
+public:
+	// plain data appended in order, read back by Reader in the same order
+	class Writer {
+	public:
+		template<typename T>
+		void write(const T& value) {
+			const char* bytes = reinterpret_cast<const char*>(&value);
+			data.insert(data.end(), bytes, bytes + sizeof(T));
+		}
+		template<typename T>
+		void writeArray(const std::vector<T>& values) {
+			write(static_cast<uint64_t>(values.size()));
+			const char* bytes = reinterpret_cast<const char*>(values.data());
+			data.insert(data.end(), bytes, bytes + values.size() * sizeof(T));
+		}
+
+		std::vector<char> data;
+	};
+
+	// throws when it runs past the end
+	class Reader {
+	public:
+		Reader(const char* dataIn, size_t sizeIn) : data(dataIn), size(sizeIn) {}
+
+		template<typename T>
+		T read() {
+			T value;
+			memcpy(&value, take(sizeof(T)), sizeof(T));
+			return value;
+		}
+		template<typename T>
+		std::vector<T> readArray() {
+			uint64_t count = read<uint64_t>();
+			if (count > (size - offset) / sizeof(T)) {
+				throw std::runtime_error("Truncated asset cache entry!");
+			}
+			std::vector<T> values(static_cast<size_t>(count));
+			memcpy(values.data(), take(values.size() * sizeof(T)), values.size() * sizeof(T));
+			return values;
+		}
+		// the next size bytes, in place
+		const char* take(size_t bytes) {
+			if (bytes > size - offset) {
+				throw std::runtime_error("Truncated asset cache entry!");
+			}
+			const char* result = data + offset;
+			offset += bytes;
+			return result;
+		}
+
+	private:
+		const char* data;
+		size_t size;
+		size_t offset = 0;
+	};
+
+	// creates the directory if needed and evicts down to maxSize; a cache that was never created misses every lookup
+	void create(const std::string& directory, uint64_t maxSize = DefaultMaxSize);
+	bool isEnabled() const { return !directory.empty(); }
+
+	// kind names the processing, e.g. "mesh"; a missing or damaged entry is a miss
+	bool load(const std::string& kind, uint64_t key, std::vector<char>& data) const;
+	void store(const std::string& kind, uint64_t key, const std::vector<char>& data) const;
+
+	uint32_t getHits() const { return hits; }
+	uint32_t getMisses() const { return misses; }
+
+	static uint64_t hash(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+private:
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint64_t key;
+		uint64_t size;
+		uint64_t storedSize;
+		// of the uncompressed data, LZ4 itself doesn't notice a flipped literal
+		uint64_t checksum;
+	};
+
+	static const uint32_t Version = 1;
+	static const uint64_t DefaultMaxSize = 512ull << 20;
+
+	void evict(uint64_t maxSize) const;
+	std::string getPath(const std::string& kind, uint64_t key) const;
+
+	std::string directory;
+	mutable std::atomic<uint32_t> hits = { 0 };
+	mutable std::atomic<uint32_t> misses = { 0 };
+};
\ No newline at end of file
@@ -0,0 +1,609 @@
+#include "VKAsyncIO.h"
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <chrono>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define VK_ASYNC_IO_URING
+#endif
+#endif
+
+namespace {
+	const size_t MaxPooledBuffers = 8;
+}
+
+#ifdef VK_ASYNC_IO_URING
+
+namespace {
+	const unsigned RingEntries = 64;
+	// big enough to keep the device busy, small enough that a few files share the queue
+	const size_t ChunkSize = 1 << 20;
+}
+
+// io_uring through the raw syscalls, the submission and completion rings are mapped from the kernel.
+// Only the reader thread touches it.
+struct VKAsyncIO::Ring {
+	struct Chunk;
+
+	struct FileRead {
+		std::shared_ptr<Request> request;
+		int fd = -1;
+		std::vector<Chunk> chunks;
+		size_t chunksLeft = 0;
+		bool failed = false;
+	};
+
+	struct Chunk {
+		FileRead* file;
+		size_t offset;
+		size_t length;
+		iovec iov;
+	};
+
+	int fd = -1;
+	unsigned entries = 0;
+
+	void* sqRing = nullptr;
+	size_t sqRingSize = 0;
+	void* cqRing = nullptr;
+	size_t cqRingSize = 0;
+	io_uring_sqe* sqes = nullptr;
+	size_t sqesSize = 0;
+
+	unsigned* sqTail = nullptr;
+	unsigned* sqHead = nullptr;
+	unsigned sqMask = 0;
+	unsigned* sqArray = nullptr;
+	unsigned* cqHead = nullptr;
+	unsigned* cqTail = nullptr;
+	unsigned cqMask = 0;
+	io_uring_cqe* cqes = nullptr;
+
+	// pushed to the submission ring but not handed to the kernel yet
+	unsigned unsubmitted = 0;
+
+	~Ring() {
+		if (sqes != nullptr) {
+			munmap(sqes, sqesSize);
+		}
+		if (cqRing != nullptr && cqRing != sqRing) {
+			munmap(cqRing, cqRingSize);
+		}
+		if (sqRing != nullptr) {
+			munmap(sqRing, sqRingSize);
+		}
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+
+	bool create() {
+		io_uring_params params = {};
+		fd = static_cast<int>(syscall(__NR_io_uring_setup, RingEntries, &params));
+		if (fd < 0) {
+			// too old a kernel, or blocked by a sandbox
+			return false;
+		}
+		entries = params.sq_entries;
+
+		sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (singleMap) {
+			sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+		}
+
+		sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+		if (sqRing == MAP_FAILED) {
+			sqRing = nullptr;
+			return false;
+		}
+		if (singleMap) {
+			cqRing = sqRing;
+		}
+		else {
+			cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+			if (cqRing == MAP_FAILED) {
+				cqRing = nullptr;
+				return false;
+			}
+		}
+		sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+		void* sqesMap = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+		if (sqesMap == MAP_FAILED) {
+			return false;
+		}
+		sqes = static_cast<io_uring_sqe*>(sqesMap);
+
+		char* sq = static_cast<char*>(sqRing);
+		sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+		sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+		sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+		sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+		char* cq = static_cast<char*>(cqRing);
+		cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+		cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+		cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+		cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+		return true;
+	}
+
+	bool push(Chunk* chunk) {
+		unsigned tail = *sqTail;
+		if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) == entries) {
+			return false;
+		}
+
+		Request& request = *chunk->file->request;
+		chunk->iov.iov_base = request.buffer.data.get() + (chunk->offset - request.offset);
+		chunk->iov.iov_len = chunk->length;
+
+		unsigned index = tail & sqMask;
+		io_uring_sqe& sqe = sqes[index];
+		sqe = {};
+		sqe.opcode = IORING_OP_READV;
+		sqe.fd = chunk->file->fd;
+		sqe.off = chunk->offset;
+		sqe.addr = reinterpret_cast<uint64_t>(&chunk->iov);
+		sqe.len = 1;
+		sqe.user_data = reinterpret_cast<uint64_t>(chunk);
+		sqArray[index] = index;
+
+		__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+		unsubmitted++;
+		return true;
+	}
+
+	// false if the ring can't be used any more
+	bool enter(unsigned minComplete) {
+		while (true) {
+			unsigned flags = minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+			int submitted = static_cast<int>(syscall(__NR_io_uring_enter, fd, unsubmitted, minComplete, flags, nullptr, 0));
+			if (submitted >= 0) {
+				unsubmitted -= static_cast<unsigned>(submitted);
+				return true;
+			}
+			if (errno == EAGAIN || errno == EBUSY) {
+				// out of kernel resources for now, give completions a moment to drain
+				std::this_thread::yield();
+			}
+			else if (errno != EINTR) {
+				return false;
+			}
+		}
+	}
+
+	// takes back the chunks pushed but never handed to the kernel
+	template<typename Func>
+	void dropUnsubmitted(Func onDropped) {
+		unsigned tail = *sqTail;
+		unsigned head = tail - unsubmitted;
+		for (; head != tail; head++) {
+			onDropped(reinterpret_cast<Chunk*>(sqes[sqArray[head & sqMask]].user_data));
+		}
+		__atomic_store_n(sqTail, tail - unsubmitted, __ATOMIC_RELEASE);
+		unsubmitted = 0;
+	}
+
+	template<typename Func>
+	unsigned reap(Func onComplete) {
+		unsigned head = *cqHead;
+		unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+		unsigned count = 0;
+		for (; head != tail; head++, count++) {
+			const io_uring_cqe& cqe = cqes[head & cqMask];
+			onComplete(reinterpret_cast<Chunk*>(cqe.user_data), cqe.res);
+		}
+		__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+		return count;
+	}
+};
+
+#else
+
+struct VKAsyncIO::Ring {
+};
+
+#endif
+
+VKAsyncIO::VKAsyncIO() = default;
+
+VKAsyncIO::~VKAsyncIO() {
+	destroy();
+}
+
+void VKAsyncIO::create(uint32_t workerCount) {
+	stopping = false;
+
+#ifdef VK_ASYNC_IO_URING
+	ring = std::make_unique<Ring>();
+	if (ring->create()) {
+		reader = std::thread(&VKAsyncIO::readerLoop, this);
+	}
+	else {
+		ring.reset();
+	}
+#endif
+
+	// without io_uring the workers do the reading too
+	for (uint32_t i = 0; i < std::max(workerCount, 1u); i++) {
+		workers.emplace_back(&VKAsyncIO::workerLoop, this);
+	}
+}
+
+void VKAsyncIO::destroy() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		reads.clear();
+	}
+	readQueued.notify_all();
+	workQueued.notify_all();
+
+	if (reader.joinable()) {
+		reader.join();
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+	ring.reset();
+
+	workerJobs.clear();
+	mainJobs.clear();
+	outstanding = 0;
+	firstError = nullptr;
+	ringFailed = false;
+	freeBuffers.clear();
+}
+
+void VKAsyncIO::read(const std::string& fileName, DecodeFunc decodeFunc) {
+	auto request = std::make_shared<Request>();
+	request->fileName = fileName;
+	request->decode = std::move(decodeFunc);
+	queueRead(request);
+}
+
+void VKAsyncIO::read(const std::string& fileName, size_t offset, size_t size, DecodeFunc decodeFunc) {
+	auto request = std::make_shared<Request>();
+	request->fileName = fileName;
+	request->decode = std::move(decodeFunc);
+	request->offset = offset;
+	request->size = size;
+	request->wholeFile = false;
+	queueRead(request);
+}
+
+void VKAsyncIO::queueRead(std::shared_ptr<Request> request) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		outstanding++;
+		if (ring && !ringFailed) {
+			reads.push_back(request);
+			readQueued.notify_one();
+			return;
+		}
+	}
+	queueBlockingRead(request);
+}
+
+void VKAsyncIO::queueBlockingRead(std::shared_ptr<Request> request) {
+	queueWork([this, request]() {
+		readBlocking(*request);
+		decode(request);
+	});
+}
+
+void VKAsyncIO::runOnMainThread(std::function<void()> job) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		outstanding++;
+		mainJobs.push_back(std::move(job));
+	}
+	mainQueued.notify_all();
+}
+
+void VKAsyncIO::waitIdle() {
+	std::exception_ptr error;
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			mainQueued.wait(lock, [this]() { return !mainJobs.empty() || outstanding == 0; });
+			if (mainJobs.empty()) {
+				std::swap(error, firstError);
+				break;
+			}
+			job = std::move(mainJobs.front());
+			mainJobs.pop_front();
+		}
+
+		std::exception_ptr jobError;
+		try {
+			job();
+		}
+		catch (...) {
+			jobError = std::current_exception();
+		}
+		finishJob(jobError);
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+bool VKAsyncIO::isUsingIoUring() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return ring != nullptr && !ringFailed;
+}
+
+size_t VKAsyncIO::getPooledBufferCount() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return freeBuffers.size();
+}
+
+void VKAsyncIO::readerLoop() {
+#ifdef VK_ASYNC_IO_URING
+	// chunks waiting for room in the submission ring
+	std::deque<Ring::Chunk*> queued;
+	unsigned inFlight = 0;
+
+	auto finishChunk = [this](Ring::FileRead* file) {
+		if (--file->chunksLeft > 0) {
+			return;
+		}
+		close(file->fd);
+		std::shared_ptr<Request> request = file->request;
+		bool failed = file->failed;
+		delete file;
+
+		if (failed) {
+			// read it again the plain way, which also reports why it failed
+			queueBlockingRead(request);
+		}
+		else {
+			queueWork([this, request]() { decode(request); });
+		}
+	};
+
+	auto failChunk = [&finishChunk](Ring::Chunk* chunk) {
+		chunk->file->failed = true;
+		finishChunk(chunk->file);
+	};
+
+	// the kernel still writes into the buffers of chunks in flight, they must land before their requests finish
+	auto abandonRing = [&]() {
+		for (Ring::Chunk* chunk : queued) {
+			failChunk(chunk);
+		}
+		queued.clear();
+		inFlight -= ring->unsubmitted;
+		ring->dropUnsubmitted(failChunk);
+		while (inFlight > 0) {
+			unsigned reaped = ring->reap([&](Ring::Chunk* chunk, int) { failChunk(chunk); });
+			if (reaped == 0) {
+				// entering the kernel to wait is what failed, so poll the completion ring
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			inFlight -= reaped;
+		}
+	};
+
+	while (true) {
+		std::deque<std::shared_ptr<Request>> newReads;
+		bool stop;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (inFlight == 0 && queued.empty()) {
+				readQueued.wait(lock, [this]() { return stopping || !reads.empty(); });
+			}
+			stop = stopping;
+			newReads.swap(reads);
+		}
+
+		if (stop) {
+			for (Ring::Chunk* chunk : queued) {
+				failChunk(chunk);
+			}
+			queued.clear();
+			while (inFlight > 0) {
+				if (!ring->enter(1)) {
+					abandonRing();
+					break;
+				}
+				inFlight -= ring->reap([&](Ring::Chunk* chunk, int) { finishChunk(chunk->file); });
+			}
+			return;
+		}
+
+		for (std::shared_ptr<Request>& request : newReads) {
+			int fd = open(request->fileName.c_str(), O_RDONLY | O_CLOEXEC);
+			struct stat info;
+			bool readable = fd >= 0 && fstat(fd, &info) == 0;
+			if (readable && request->wholeFile) {
+				request->size = static_cast<size_t>(info.st_size);
+			}
+			if (!readable || request->size == 0 || request->offset + request->size > static_cast<size_t>(info.st_size)) {
+				if (fd >= 0) {
+					close(fd);
+				}
+				// empty, short or unreadable, the blocking path sorts out which
+				queueBlockingRead(request);
+				continue;
+			}
+
+			request->buffer = acquireBuffer(request->size);
+
+			Ring::FileRead* file = new Ring::FileRead();
+			file->request = request;
+			file->fd = fd;
+			size_t end = request->offset + request->size;
+			for (size_t offset = request->offset; offset < end; offset += ChunkSize) {
+				file->chunks.push_back({ file, offset, std::min(ChunkSize, end - offset), {} });
+			}
+			file->chunksLeft = file->chunks.size();
+			for (Ring::Chunk& chunk : file->chunks) {
+				queued.push_back(&chunk);
+			}
+		}
+
+		while (!queued.empty() && inFlight < ring->entries && ring->push(queued.front())) {
+			queued.pop_front();
+			inFlight++;
+		}
+
+		if (!ring->enter(inFlight > 0 ? 1 : 0)) {
+			std::cerr << "io_uring_enter failed (" << strerror(errno) << "), reading without it" << std::endl;
+			abandonRing();
+			break;
+		}
+
+		inFlight -= ring->reap([&](Ring::Chunk* chunk, int result) {
+			if (result > 0 && static_cast<size_t>(result) < chunk->length) {
+				// short read, ask for the rest
+				chunk->offset += result;
+				chunk->length -= result;
+				queued.push_front(chunk);
+				return;
+			}
+			if (result <= 0) {
+				chunk->file->failed = true;
+			}
+			finishChunk(chunk->file);
+		});
+	}
+
+	// from here on queueRead hands reads to the workers, send them the ones it already gave to the ring
+	std::deque<std::shared_ptr<Request>> leftReads;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		ringFailed = true;
+		leftReads.swap(reads);
+	}
+	for (std::shared_ptr<Request>& request : leftReads) {
+		queueBlockingRead(request);
+	}
+#endif
+}
+
+void VKAsyncIO::workerLoop() {
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			workQueued.wait(lock, [this]() { return stopping || !workerJobs.empty(); });
+			if (stopping) {
+				return;
+			}
+			job = std::move(workerJobs.front());
+			workerJobs.pop_front();
+		}
+		job();
+	}
+}
+
+void VKAsyncIO::readBlocking(Request& request) {
+	try {
+		std::ifstream file(request.fileName, std::ios::ate | std::ios::binary);
+		if (!file.is_open()) {
+			throw std::runtime_error("Failed to open " + request.fileName + "!");
+		}
+
+		if (request.wholeFile) {
+			request.size = static_cast<size_t>(file.tellg());
+		}
+		if (request.buffer.size < request.size) {
+			releaseBuffer(std::move(request.buffer));
+			request.buffer = acquireBuffer(request.size);
+		}
+		file.seekg(request.offset);
+		if (!file.read(request.buffer.data.get(), request.size)) {
+			throw std::runtime_error("Failed to read " + request.fileName + "!");
+		}
+	}
+	catch (...) {
+		request.error = std::current_exception();
+	}
+}
+
+void VKAsyncIO::decode(std::shared_ptr<Request> request) {
+	if (!request->error) {
+		try {
+			request->decode(request->buffer.data.get(), request->size);
+		}
+		catch (...) {
+			request->error = std::current_exception();
+		}
+	}
+
+	releaseBuffer(std::move(request->buffer));
+	finishJob(request->error);
+}
+
+void VKAsyncIO::queueWork(std::function<void()> job) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		workerJobs.push_back(std::move(job));
+	}
+	workQueued.notify_one();
+}
+
+void VKAsyncIO::finishJob(std::exception_ptr error) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (error && !firstError) {
+			firstError = error;
+		}
+		outstanding--;
+	}
+	mainQueued.notify_all();
+}
+
+VKAsyncIO::Buffer VKAsyncIO::acquireBuffer(size_t size) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto best = freeBuffers.end();
+		for (auto it = freeBuffers.begin(); it != freeBuffers.end(); ++it) {
+			if (it->size >= size && (best == freeBuffers.end() || it->size < best->size)) {
+				best = it;
+			}
+		}
+		if (best != freeBuffers.end()) {
+			Buffer buffer = std::move(*best);
+			freeBuffers.erase(best);
+			return buffer;
+		}
+	}
+	return { std::unique_ptr<char[]>(new char[size]), size };
+}
+
+void VKAsyncIO::releaseBuffer(Buffer buffer) {
+	if (buffer.size == 0) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	freeBuffers.push_back(std::move(buffer));
+	if (freeBuffers.size() > MaxPooledBuffers) {
+		// the smallest one is the least likely to fit the next file
+		auto smallest = std::min_element(freeBuffers.begin(), freeBuffers.end(), [](const Buffer& a, const Buffer& b) {
+			return a.size < b.size;
+		});
+		freeBuffers.erase(smallest);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+// Asset loading that overlaps disk, decode and upload. Whole files are read into pooled buffers,
+// in batches through io_uring on Linux and by the worker threads elsewhere. Each finished read runs
+// its decode function on a worker, and decoders hand GPU work to runOnMainThread, which waitIdle
+// executes on the calling thread while other files are still being read and decoded.
+class VKAsyncIO
+{
+public:
+	// runs on a worker thread; data is only valid during the call
+	using DecodeFunc = std::function<void(const char* data, size_t size)>;
+
+	VKAsyncIO(const VKAsyncIO&) = delete;
+	VKAsyncIO();
+	~VKAsyncIO();
+
+	void create(uint32_t workerCount);
+	// drops work that hasn't started, call waitIdle first to finish it
+	void destroy();
+
+	void read(const std::string& fileName, DecodeFunc decode);
+	// reads size bytes at offset, e.g. one entry of an archive
+	void read(const std::string& fileName, size_t offset, size_t size, DecodeFunc decode);
+	void runOnMainThread(std::function<void()> job);
+	// runs main thread jobs until every read, decode and main thread job has finished,
+	// then rethrows the first error any of them raised
+	void waitIdle();
+
+	bool isUsingIoUring() const;
+	size_t getPooledBufferCount() const;
+
+private:
+	// not zeroed, every byte a request uses is read into it first
+	struct Buffer {
+		std::unique_ptr<char[]> data;
+		size_t size = 0;
+	};
+
+	struct Request {
+		std::string fileName;
+		DecodeFunc decode;
+		Buffer buffer;
+		size_t offset = 0;
+		size_t size = 0;
+		bool wholeFile = true;
+		std::exception_ptr error;
+	};
+
+	struct Ring;
+
+	void queueRead(std::shared_ptr<Request> request);
+	void readerLoop();
+	void workerLoop();
+	// reads and decodes on a worker, without the ring
+	void queueBlockingRead(std::shared_ptr<Request> request);
+	void readBlocking(Request& request);
+	void decode(std::shared_ptr<Request> request);
+	void queueWork(std::function<void()> job);
+	void finishJob(std::exception_ptr error);
+
+	Buffer acquireBuffer(size_t size);
+	void releaseBuffer(Buffer buffer);
+
+	std::unique_ptr<Ring> ring;
+	std::thread reader;
+	std::vector<std::thread> workers;
+
+	mutable std::mutex mutex;
+	std::condition_variable readQueued;
+	std::condition_variable workQueued;
+	std::condition_variable mainQueued;
+
+	std::deque<std::shared_ptr<Request>> reads;
+	std::deque<std::function<void()>> workerJobs;
+	std::deque<std::function<void()>> mainJobs;
+	// reads with their decode, and main thread jobs, that haven't finished
+	size_t outstanding = 0;
+	std::exception_ptr firstError;
+	bool stopping = false;
+	// set by the reader when io_uring_enter fails, the reads left are done by the workers
+	bool ringFailed = false;
+
+	// free buffers keep their full size, a request only uses the front of one
+	std::vector<Buffer> freeBuffers;
+};
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "VKBuffer.h"
 #include "VKCommandBuffer.h"
+#include "VKTimeline.h"
 
 VkDevice VKBuffer::device = nullptr;
 VkPhysicalDevice VKBuffer::physicalDevice = nullptr;
@@ -17,10 +18,29 @@ VKBuffer::~VKBuffer()
 
 void VKBuffer::clear()
 {
-	if (buffer)
+	if (buffer) {
 		vkDestroyBuffer(device, buffer, nullptr);
-	if (bufferMemory)
+		buffer = VK_NULL_HANDLE;
+	}
+	if (bufferMemory) {
 		vkFreeMemory(device, bufferMemory, nullptr);
+		bufferMemory = VK_NULL_HANDLE;
+	}
+}
+
+void VKBuffer::clearDeferred()
+{
+	VkBuffer oldBuffer = buffer;
+	VkDeviceMemory oldMemory = bufferMemory;
+	VKTimeline::deferDestroy([oldBuffer, oldMemory]() {
+		if (oldBuffer)
+			vkDestroyBuffer(device, oldBuffer, nullptr);
+		if (oldMemory)
+			vkFreeMemory(device, oldMemory, nullptr);
+	});
+
+	buffer = VK_NULL_HANDLE;
+	bufferMemory = VK_NULL_HANDLE;
 }
 
 void VKBuffer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VKBuffer* buffer) {
@@ -52,6 +72,18 @@ void VKBuffer::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize s
 	copyRegion.size = size;
 	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
+	// the copy is no longer waited on by the host, make it visible to whatever reads the buffer next
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr);
+
 	VKCommandBuffer::endSingleTimeCommands(commandBuffer);
 }
 
@@ -68,6 +100,8 @@ void VKBuffer::createBuffer(VkDeviceSize size, void* data, VkBufferUsageFlags us
 	createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, this);
 
 	copyBuffer(stagingBuffer.buffer, buffer, size);
+
+	stagingBuffer.clearDeferred();
 }
 
 uint32_t VKBuffer::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
@@ -11,6 +11,7 @@ public:
 	~VKBuffer();
 
 	void clear();
+	void clearDeferred();
 
 	static void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VKBuffer* buffer);
 	static void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -1,9 +1,7 @@
 #include "VKCommandBuffer.h"
-
-#include <array>
+#include "VKTimeline.h"
 
 VkCommandPool VKCommandBuffer::commandPool = nullptr;
-std::vector<VkCommandBuffer> VKCommandBuffer::commandBuffers;
 VkDevice VKCommandBuffer::device = nullptr;
 VkQueue VKCommandBuffer::graphicsQueue = nullptr;
 
@@ -14,7 +12,7 @@ void VKCommandBuffer::createCommandPool(VkDevice deviceIn, VkQueue graphicsQueue
 
 	VkCommandPoolCreateInfo info = {};
 	info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	info.flags = 0;
+	info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 	info.queueFamilyIndex = graphicsFamilyIndex;
 
 	VULKAN_CHECK_RESULT(vkCreateCommandPool(device, &info, nullptr, &commandPool), "Failed to create command pool!");
@@ -24,67 +22,20 @@ void VKCommandBuffer::destroyCommandPool() {
 	vkDestroyCommandPool(device, commandPool, nullptr);
 }
 
-void VKCommandBuffer::createCommandBuffers(std::vector<VkFramebuffer> swapChainFramebuffers, VkRenderPass renderPass, VkPipeline pipeline, VkPipelineLayout pipelineLayout, 
-	std::vector<VkDescriptorSet> descriptorSets, VkExtent2D extent, VkBuffer vertexBuffer, VkBuffer indexBuffer, std::vector<uint32_t> indices) {
-	commandBuffers.resize(swapChainFramebuffers.size());
-
-	VkCommandBufferAllocateInfo  info = {};
+VkCommandBuffer VKCommandBuffer::allocateCommandBuffer() {
+	VkCommandBufferAllocateInfo info = {};
 	info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	info.commandPool = VKCommandBuffer::commandPool;
+	info.commandPool = commandPool;
 	info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	info.commandBufferCount = (uint32_t)commandBuffers.size();
-
-	VULKAN_CHECK_RESULT(vkAllocateCommandBuffers(device, &info, commandBuffers.data()), "Failed to create command buffer!");
-
-	for (size_t i = 0; i < commandBuffers.size(); i++) {
-		VkCommandBufferBeginInfo beginInfo = {};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-		beginInfo.pInheritanceInfo = nullptr;
-
-		VULKAN_CHECK_RESULT(vkBeginCommandBuffer(commandBuffers[i], &beginInfo), "Failed to begin recording command buffer!");
-
-		VkRenderPassBeginInfo renderPassInfo = {};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = renderPass;
-		renderPassInfo.framebuffer = swapChainFramebuffers[i];
-
-		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = extent;
-
-		std::array<VkClearValue, 3> clearValues = {};
-		clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-		clearValues[1].depthStencil = { 1.0f, 0 };
-		clearValues[2].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-
-		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-		renderPassInfo.pClearValues = clearValues.data();
-
-		vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-		vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-
-		VkBuffer vertexBuffers[] = { vertexBuffer };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
-
-		vkCmdBindIndexBuffer(commandBuffers[i], indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-		vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[i], 0, nullptr);
+	info.commandBufferCount = 1;
 
-		vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
-
-		vkCmdEndRenderPass(commandBuffers[i]);
-
-		VULKAN_CHECK_RESULT(vkEndCommandBuffer(commandBuffers[i]), "Failed to record command buffer!");
-	}
-}
-
-VkCommandBuffer* VKCommandBuffer::getCommandBuffer(int imageIndex) {
-	return &commandBuffers[imageIndex];
+	VkCommandBuffer commandBuffer;
+	VULKAN_CHECK_RESULT(vkAllocateCommandBuffers(device, &info, &commandBuffer), "Failed to create command buffer!");
+	return commandBuffer;
 }
 
-void VKCommandBuffer::freeCommandBuffers() {
-	vkFreeCommandBuffers(device, VKCommandBuffer::commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+void VKCommandBuffer::freeCommandBuffer(VkCommandBuffer commandBuffer) {
+	vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 }
 
 VkCommandBuffer VKCommandBuffer::beginSingleTimeCommands() {
@@ -106,16 +57,31 @@ VkCommandBuffer VKCommandBuffer::beginSingleTimeCommands() {
 	return commandBuffer;
 }
 
-void VKCommandBuffer::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
+uint64_t VKCommandBuffer::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
 	vkEndCommandBuffer(commandBuffer);
 
+	uint64_t signalValue = VKTimeline::nextSignalValue();
+
+	VkTimelineSemaphoreSubmitInfoKHR timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &signalValue;
+
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &VKTimeline::semaphore;
 
-	vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(graphicsQueue);
+	VULKAN_CHECK_RESULT(vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE), "Failed to submit single time commands!");
 
-	vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
-}
+	// no host wait: later submits on the queue are ordered after this one, the command buffer is freed once the timeline passes it
+	VkCommandPool pool = commandPool;
+	VKTimeline::deferDestroy(signalValue, [pool, commandBuffer]() {
+		vkFreeCommandBuffers(device, pool, 1, &commandBuffer);
+	});
+
+	return signalValue;
+}
\ No newline at end of file
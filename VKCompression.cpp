@@ -0,0 +1,150 @@
+#include "VKCompression.h"
+
+#include <cstring>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+namespace {
+	const size_t MinMatch = 4;
+	// the format wants the last 5 bytes as literals, and no match starting in the last 12
+	const size_t LastLiterals = 5;
+	const size_t MatchSearchEnd = 12;
+	const size_t MaxOffset = 65535;
+	const int HashBits = 14;
+
+	uint32_t read32(const char* data) {
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	uint32_t hashSequence(uint32_t sequence) {
+		return (sequence * 2654435761u) >> (32 - HashBits);
+	}
+}
+
+std::vector<char> VKCompression::compress(const char* data, size_t size) {
+	std::vector<char> out;
+	out.reserve(size + size / 255 + 16);
+
+	// position + 1 of the last place each hashed sequence was seen, 0 for never
+	std::vector<uint32_t> table(size_t(1) << HashBits, 0);
+
+	size_t anchor = 0;
+	size_t pos = 0;
+	while (size > MatchSearchEnd && pos < size - MatchSearchEnd) {
+		uint32_t sequence = read32(data + pos);
+		uint32_t& slot = table[hashSequence(sequence)];
+		size_t candidate = slot;
+		slot = static_cast<uint32_t>(pos + 1);
+
+		if (candidate == 0 || pos - (candidate - 1) > MaxOffset || read32(data + candidate - 1) != sequence) {
+			pos++;
+			continue;
+		}
+		candidate--;
+
+		size_t length = MinMatch;
+		while (pos + length < size - LastLiterals && data[candidate + length] == data[pos + length]) {
+			length++;
+		}
+
+		writeSequence(out, data + anchor, pos - anchor, pos - candidate, length);
+		pos += length;
+		anchor = pos;
+	}
+
+	// the last literals go without a match
+	size_t literalLength = size - anchor;
+	out.push_back(static_cast<char>(std::min<size_t>(literalLength, 15) << 4));
+	if (literalLength >= 15) {
+		writeLength(out, literalLength - 15);
+	}
+	out.insert(out.end(), data + anchor, data + size);
+	return out;
+}
+
+void VKCompression::decompress(const char* data, size_t size, char* output, size_t outputSize) {
+	const uint8_t* in = reinterpret_cast<const uint8_t*>(data);
+	const uint8_t* inEnd = in + size;
+	char* out = output;
+	char* outEnd = output + outputSize;
+
+	auto readLength = [&](size_t length) {
+		if (length != 15) {
+			return length;
+		}
+		uint8_t byte;
+		do {
+			if (in == inEnd) {
+				throw std::runtime_error("Corrupt compressed data!");
+			}
+			byte = *in++;
+			length += byte;
+		} while (byte == 255);
+		return length;
+	};
+
+	while (in < inEnd) {
+		uint8_t token = *in++;
+
+		size_t literalLength = readLength(token >> 4);
+		if (literalLength > size_t(inEnd - in) || literalLength > size_t(outEnd - out)) {
+			throw std::runtime_error("Corrupt compressed data!");
+		}
+		if (literalLength > 0) {
+			memcpy(out, in, literalLength);
+		}
+		in += literalLength;
+		out += literalLength;
+
+		if (in == inEnd) {
+			break;
+		}
+
+		if (inEnd - in < 2) {
+			throw std::runtime_error("Corrupt compressed data!");
+		}
+		size_t offset = in[0] | (in[1] << 8);
+		in += 2;
+
+		size_t matchLength = readLength(token & 15) + MinMatch;
+		if (offset == 0 || offset > size_t(out - output) || matchLength > size_t(outEnd - out)) {
+			throw std::runtime_error("Corrupt compressed data!");
+		}
+		// matches may overlap their own output, so byte by byte
+		const char* match = out - offset;
+		for (size_t i = 0; i < matchLength; i++) {
+			out[i] = match[i];
+		}
+		out += matchLength;
+	}
+
+	if (out != outEnd) {
+		throw std::runtime_error("Corrupt compressed data!");
+	}
+}
+
+void VKCompression::writeLength(std::vector<char>& out, size_t length) {
+	while (length >= 255) {
+		out.push_back(static_cast<char>(255));
+		length -= 255;
+	}
+	out.push_back(static_cast<char>(length));
+}
+
+void VKCompression::writeSequence(std::vector<char>& out, const char* literals, size_t literalLength, size_t offset, size_t matchLength) {
+	size_t extraMatch = matchLength - MinMatch;
+	out.push_back(static_cast<char>((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(extraMatch, 15)));
+	if (literalLength >= 15) {
+		writeLength(out, literalLength - 15);
+	}
+	out.insert(out.end(), literals, literals + literalLength);
+
+	out.push_back(static_cast<char>(offset & 0xFF));
+	out.push_back(static_cast<char>(offset >> 8));
+	if (extraMatch >= 15) {
+		writeLength(out, extraMatch - 15);
+	}
+}
\ No newline at end of file
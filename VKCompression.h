@@ -0,0 +1,18 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+// LZ4 block format: a fast greedy compressor, and a bounds checked decompressor that throws on
+// corrupt input. There is no frame, the caller stores both sizes.
+class VKCompression
+{
+public:
+	static std::vector<char> compress(const char* data, size_t size);
+	// output must hold exactly the original size
+	static void decompress(const char* data, size_t size, char* output, size_t outputSize);
+
+private:
+	static void writeLength(std::vector<char>& out, size_t length);
+	static void writeSequence(std::vector<char>& out, const char* literals, size_t literalLength, size_t offset, size_t matchLength);
+};
\ No newline at end of file
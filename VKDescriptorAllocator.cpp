@@ -0,0 +1,108 @@
+#include "VKDescriptorAllocator.h"
+
+#include <functional>
+
+VkDevice VKDescriptorAllocator::device = nullptr;
+
+bool VKDescriptorAllocator::CacheKey::operator==(const CacheKey& other) const {
+	return layout == other.layout && bindings == other.bindings;
+}
+
+size_t VKDescriptorAllocator::CacheKeyHash::operator()(const CacheKey& key) const {
+	size_t hash = std::hash<const void*>()(key.layout);
+	auto combine = [&hash](size_t value) {
+		hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	};
+
+	for (const VKDescriptorBinding& binding : key.bindings) {
+		combine(binding.binding);
+		combine(binding.type);
+		combine(std::hash<const void*>()(binding.bufferInfo.buffer));
+		combine(binding.bufferInfo.offset);
+		combine(binding.bufferInfo.range);
+		combine(std::hash<const void*>()(binding.imageInfo.imageView));
+		combine(std::hash<const void*>()(binding.imageInfo.sampler));
+	}
+	return hash;
+}
+
+void VKDescriptorAllocator::initDevices(VkDevice deviceIn) {
+	device = deviceIn;
+	VKDescriptorWriter::initDevices(device);
+}
+
+VKDescriptorAllocator::~VKDescriptorAllocator() {
+	clear();
+}
+
+VkDescriptorSet VKDescriptorAllocator::getSet(VkDescriptorSetLayout layout, const std::vector<VKDescriptorBinding>& bindings) {
+	CacheKey key = { layout, bindings };
+	auto cached = cache.find(key);
+	if (cached != cache.end()) {
+		return cached->second;
+	}
+
+	VkDescriptorSet set = allocate(layout);
+	writer.queue(set, layout, bindings);
+	cache.emplace(std::move(key), set);
+	return set;
+}
+
+void VKDescriptorAllocator::clear() {
+	for (VkDescriptorPool pool : pools) {
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	}
+	pools.clear();
+
+	cache.clear();
+	writer.clear();
+}
+
+void VKDescriptorAllocator::flush() {
+	writer.flush();
+}
+
+VkDescriptorPool VKDescriptorAllocator::createPool() {
+	// the ratios only decide how often a pool fills up
+	std::vector<VkDescriptorPoolSize> poolSizes = poolRatios;
+	for (VkDescriptorPoolSize& poolSize : poolSizes) {
+		poolSize.descriptorCount *= setsPerPool;
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = setsPerPool;
+
+	VkDescriptorPool pool;
+	VULKAN_CHECK_RESULT(vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool), "Failed to create descriptor pool!");
+	pools.push_back(pool);
+	return pool;
+}
+
+VkDescriptorSet VKDescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+	if (pools.empty()) {
+		createPool();
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = pools.back();
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	VkDescriptorSet set;
+	VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+		// full, keep it for its sets and move on to a fresh pool
+		allocInfo.descriptorPool = createPool();
+		result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+
+		// even an empty pool can't hold it
+		CHECK_RESULT((result != VK_ERROR_OUT_OF_POOL_MEMORY), "Descriptor set layout uses types missing from poolRatios!");
+	}
+	VULKAN_CHECK_RESULT(result, "Failed to allocate descriptor set!");
+
+	return set;
+}
\ No newline at end of file
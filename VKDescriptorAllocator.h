@@ -0,0 +1,63 @@
+#pragma once
+
+#include "VKDescriptorWriter.h"
+
+#include <vector>
+#include <unordered_map>
+
+// Descriptor sets from a chain of fixed size pools: when a pool runs out a new one is created,
+// so allocation never fails because the scene outgrew a pool. Sets built from the same layout and
+// bindings are shared.
+class VKDescriptorAllocator
+{
+public:
+	static void initDevices(VkDevice device);
+
+	VKDescriptorAllocator(const VKDescriptorAllocator&) = delete;
+	VKDescriptorAllocator() = default;
+	~VKDescriptorAllocator();
+
+	// valid until clear
+	VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+
+	// set holding the bindings, allocated and written only the first time they're asked for
+	VkDescriptorSet getSet(VkDescriptorSetLayout layout, const std::vector<VKDescriptorBinding>& bindings);
+	// applies the writes of the sets handed out since the last flush, before any of them is bound
+	void flush();
+
+	// destroys every pool and forgets the cache, nothing allocated from here may be in use
+	void clear();
+
+	size_t getPoolCount() const { return pools.size(); }
+	size_t getCachedSetCount() const { return cache.size(); }
+
+	uint32_t setsPerPool = 64;
+	// descriptors of each type per set, a pool holds setsPerPool times as many; a layout using a
+	// type missing here can't be allocated, set before the first allocation
+	std::vector<VkDescriptorPoolSize> poolRatios = {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 },
+	};
+
+private:
+	struct CacheKey {
+		VkDescriptorSetLayout layout;
+		std::vector<VKDescriptorBinding> bindings;
+
+		bool operator==(const CacheKey& other) const;
+	};
+
+	struct CacheKeyHash {
+		size_t operator()(const CacheKey& key) const;
+	};
+
+	VkDescriptorPool createPool();
+
+	// every pool ever created, owned here; the last one is allocated from
+	std::vector<VkDescriptorPool> pools;
+
+	std::unordered_map<CacheKey, VkDescriptorSet, CacheKeyHash> cache;
+	VKDescriptorWriter writer;
+
+	static VkDevice device;
+};
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "VKDescriptorWriter.h"
+
+#include <functional>
+
+VkDevice VKDescriptorWriter::device = nullptr;
+
+VKDescriptorBinding VKDescriptorBinding::buffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize range, VkDeviceSize offset) {
+	VKDescriptorBinding result;
+	result.binding = binding;
+	result.type = type;
+	result.bufferInfo = { buffer, offset, range };
+	return result;
+}
+
+VKDescriptorBinding VKDescriptorBinding::image(uint32_t binding, VkDescriptorType type, VkImageView imageView, VkSampler sampler, VkImageLayout layout) {
+	VKDescriptorBinding result;
+	result.binding = binding;
+	result.type = type;
+	result.imageInfo = { sampler, imageView, layout };
+	return result;
+}
+
+bool VKDescriptorBinding::operator==(const VKDescriptorBinding& other) const {
+	return binding == other.binding && type == other.type
+		&& bufferInfo.buffer == other.bufferInfo.buffer && bufferInfo.offset == other.bufferInfo.offset && bufferInfo.range == other.bufferInfo.range
+		&& imageInfo.sampler == other.imageInfo.sampler && imageInfo.imageView == other.imageInfo.imageView && imageInfo.imageLayout == other.imageInfo.imageLayout;
+}
+
+bool VKDescriptorWriter::TemplateKey::operator==(const TemplateKey& other) const {
+	return layout == other.layout && entries == other.entries;
+}
+
+size_t VKDescriptorWriter::TemplateKeyHash::operator()(const TemplateKey& key) const {
+	size_t hash = std::hash<const void*>()(key.layout);
+	for (const auto& entry : key.entries) {
+		hash ^= (size_t(entry.first) << 8 | entry.second) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	}
+	return hash;
+}
+
+void VKDescriptorWriter::initDevices(VkDevice deviceIn) {
+	device = deviceIn;
+}
+
+VKDescriptorWriter::~VKDescriptorWriter() {
+	clear();
+}
+
+void VKDescriptorWriter::queue(VkDescriptorSet set, VkDescriptorSetLayout layout, const std::vector<VKDescriptorBinding>& bindings) {
+	TemplateKey key = { layout, {} };
+	key.entries.reserve(bindings.size());
+
+	size_t firstInfo = pendingInfos.size();
+	for (const VKDescriptorBinding& binding : bindings) {
+		key.entries.push_back({ binding.binding, binding.type });
+
+		DescriptorInfo info = {};
+		if (binding.bufferInfo.buffer != VK_NULL_HANDLE) {
+			info.buffer = binding.bufferInfo;
+		}
+		else {
+			info.image = binding.imageInfo;
+		}
+		pendingInfos.push_back(info);
+	}
+
+	pendingUpdates.push_back({ set, getTemplate(key), firstInfo });
+}
+
+void VKDescriptorWriter::flush() {
+	for (const PendingUpdate& update : pendingUpdates) {
+		vkUpdateDescriptorSetWithTemplate(device, update.set, update.updateTemplate, &pendingInfos[update.firstInfo]);
+	}
+	pendingUpdates.clear();
+	pendingInfos.clear();
+}
+
+void VKDescriptorWriter::clear() {
+	pendingUpdates.clear();
+	pendingInfos.clear();
+
+	for (auto& entry : templates) {
+		vkDestroyDescriptorUpdateTemplate(device, entry.second, nullptr);
+	}
+	templates.clear();
+}
+
+VkDescriptorUpdateTemplate VKDescriptorWriter::getTemplate(const TemplateKey& key) {
+	auto found = templates.find(key);
+	if (found != templates.end()) {
+		return found->second;
+	}
+
+	// entry i reads the i-th packed info of the update
+	std::vector<VkDescriptorUpdateTemplateEntry> entries(key.entries.size());
+	for (size_t i = 0; i < entries.size(); i++) {
+		entries[i].dstBinding = key.entries[i].first;
+		entries[i].dstArrayElement = 0;
+		entries[i].descriptorCount = 1;
+		entries[i].descriptorType = key.entries[i].second;
+		entries[i].offset = i * sizeof(DescriptorInfo);
+		entries[i].stride = sizeof(DescriptorInfo);
+	}
+
+	VkDescriptorUpdateTemplateCreateInfo info = {};
+	info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+	info.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+	info.pDescriptorUpdateEntries = entries.data();
+	info.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+	info.descriptorSetLayout = key.layout;
+
+	VkDescriptorUpdateTemplate updateTemplate;
+	VULKAN_CHECK_RESULT(vkCreateDescriptorUpdateTemplate(device, &info, nullptr, &updateTemplate), "Failed to create descriptor update template!");
+	templates.emplace(key, updateTemplate);
+	return updateTemplate;
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "VulkanContext.h"
+
+#include <vector>
+#include <unordered_map>
+
+// contents of one binding of a descriptor set, enough to write it and to recognise an identical set
+struct VKDescriptorBinding {
+	uint32_t binding = 0;
+	VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	VkDescriptorBufferInfo bufferInfo = {};
+	VkDescriptorImageInfo imageInfo = {};
+
+	static VKDescriptorBinding buffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize range = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+	static VKDescriptorBinding image(uint32_t binding, VkDescriptorType type, VkImageView imageView, VkSampler sampler,
+		VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	bool operator==(const VKDescriptorBinding& other) const;
+};
+
+// Writes descriptor sets through VkDescriptorUpdateTemplates. A template is built once per set
+// layout and binding list; after that an update is the binding infos packed into one array,
+// which the driver copies straight into the set. Updates are queued and applied by flush.
+class VKDescriptorWriter
+{
+public:
+	static void initDevices(VkDevice device);
+
+	VKDescriptorWriter(const VKDescriptorWriter&) = delete;
+	VKDescriptorWriter() = default;
+	~VKDescriptorWriter();
+
+	void queue(VkDescriptorSet set, VkDescriptorSetLayout layout, const std::vector<VKDescriptorBinding>& bindings);
+	// must run before any queued set is bound
+	void flush();
+	void clear();
+
+	size_t getTemplateCount() const { return templates.size(); }
+
+private:
+	// one template entry reads one of these
+	union DescriptorInfo {
+		VkDescriptorBufferInfo buffer;
+		VkDescriptorImageInfo image;
+	};
+
+	struct TemplateKey {
+		VkDescriptorSetLayout layout;
+		// binding and type of every entry, in order
+		std::vector<std::pair<uint32_t, VkDescriptorType>> entries;
+
+		bool operator==(const TemplateKey& other) const;
+	};
+
+	struct TemplateKeyHash {
+		size_t operator()(const TemplateKey& key) const;
+	};
+
+	struct PendingUpdate {
+		VkDescriptorSet set;
+		VkDescriptorUpdateTemplate updateTemplate;
+		size_t firstInfo;
+	};
+
+	VkDescriptorUpdateTemplate getTemplate(const TemplateKey& key);
+
+	std::unordered_map<TemplateKey, VkDescriptorUpdateTemplate, TemplateKeyHash> templates;
+
+	std::vector<PendingUpdate> pendingUpdates;
+	std::vector<DescriptorInfo> pendingInfos;
+
+	static VkDevice device;
+};
\ No newline at end of file
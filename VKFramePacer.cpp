@@ -0,0 +1,62 @@
+#include "VKFramePacer.h"
+
+#include <algorithm>
+
+VKFramePacer::VKFramePacer() {
+	setProfile(FramePacingProfile::Throughput);
+	statsStart = Clock::now();
+}
+
+void VKFramePacer::setProfile(FramePacingProfile profileIn) {
+	profile = profileIn;
+
+	switch (profile) {
+	case FramePacingProfile::Throughput:
+		framesInFlight = 2;
+		extraSwapchainImages = 2;
+		presentModes = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_KHR };
+		justInTime = false;
+		break;
+	case FramePacingProfile::Latency:
+		framesInFlight = 1;
+		extraSwapchainImages = 0;
+		presentModes = { VK_PRESENT_MODE_FIFO_KHR };
+		justInTime = true;
+		break;
+	}
+}
+
+const char* VKFramePacer::getProfileName() const {
+	return profile == FramePacingProfile::Latency ? "latency" : "throughput";
+}
+
+void VKFramePacer::markInputSampled() {
+	inputTime = Clock::now();
+}
+
+void VKFramePacer::markPresented() {
+	double latency = std::chrono::duration<double, std::milli>(Clock::now() - inputTime).count();
+
+	latencySum += latency;
+	latencyMax = std::max(latencyMax, latency);
+	presentedFrames++;
+}
+
+bool VKFramePacer::collectStats(FramePacingStats* stats) {
+	auto now = Clock::now();
+	double elapsed = std::chrono::duration<double>(now - statsStart).count();
+	if (elapsed < 1.0 || presentedFrames == 0)
+		return false;
+
+	stats->fps = static_cast<float>(presentedFrames / elapsed);
+	stats->frameTimeMs = static_cast<float>(elapsed * 1000.0 / presentedFrames);
+	stats->latencyMs = static_cast<float>(latencySum / presentedFrames);
+	stats->maxLatencyMs = static_cast<float>(latencyMax);
+
+	statsStart = now;
+	presentedFrames = 0;
+	latencySum = 0.0;
+	latencyMax = 0.0;
+
+	return true;
+}
\ No newline at end of file
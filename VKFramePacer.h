@@ -0,0 +1,53 @@
+#pragma once
+
+#include "VulkanContext.h"
+
+#include <chrono>
+#include <vector>
+
+enum class FramePacingProfile {
+	Throughput,
+	Latency
+};
+
+struct FramePacingStats {
+	float fps = 0.f;
+	float frameTimeMs = 0.f;
+	float latencyMs = 0.f;
+	float maxLatencyMs = 0.f;
+};
+
+class VKFramePacer
+{
+public:
+	VKFramePacer();
+
+	void setProfile(FramePacingProfile profile);
+	FramePacingProfile getProfile() const { return profile; }
+	const char* getProfileName() const;
+
+	// input-to-present latency is measured from the moment events were polled
+	// to the return of vkQueuePresentKHR for the frame built from them
+	void markInputSampled();
+	void markPresented();
+
+	bool collectStats(FramePacingStats* stats);
+
+	uint32_t framesInFlight = 2;
+	uint32_t extraSwapchainImages = 1;
+	std::vector<VkPresentModeKHR> presentModes;
+
+	// wait for the previous frame on the GPU before sampling input, so the CPU never runs ahead of the display
+	bool justInTime = false;
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	FramePacingProfile profile = FramePacingProfile::Throughput;
+
+	Clock::time_point inputTime;
+	Clock::time_point statsStart;
+	uint32_t presentedFrames = 0;
+	double latencySum = 0.0;
+	double latencyMax = 0.0;
+};
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "VKImage.h"
+#include "VKSamplerCache.h"
 
 #include <algorithm>
 
@@ -11,7 +12,6 @@ void VKImage::initDevices(VkDevice deviceIn, VkPhysicalDevice physicalDeviceIn)
 {
 	device = deviceIn;
 	physicalDevice = physicalDeviceIn;
-	msaaSamples = getMaxUsableSampleCount();
 }
 
 VKImage::~VKImage()
@@ -21,10 +21,8 @@ VKImage::~VKImage()
 
 void VKImage::clear()
 {
-	if (sampler) {
-		vkDestroySampler(device, sampler, nullptr);
-		sampler = VK_NULL_HANDLE;
-	}
+	// owned by the sampler cache
+	sampler = VK_NULL_HANDLE;
 	if (imageView) {
 		vkDestroyImageView(device, imageView, nullptr);
 		imageView = VK_NULL_HANDLE;
@@ -40,20 +38,51 @@ void VKImage::clear()
 }
 
 uint32_t VKImage::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+	uint32_t memoryType;
+	CHECK_RESULT(hasMemoryType(typeFilter, properties, &memoryType), "Failed to find suitable memory type!");
+	return memoryType;
+}
+
+bool VKImage::hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t* memoryType) {
 	VkPhysicalDeviceMemoryProperties memProperties;
 	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
 
 	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
 		if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-			return i;
+			*memoryType = i;
+			return true;
 		}
 	}
 
-	CHECK_RESULT(true, "Failed to find suitable memory type!");
+	return false;
 }
 
 void VKImage::createImage(uint32_t width, uint32_t height, uint32_t mipLevelsIn, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling,
 	VkImageUsageFlags usage, VkMemoryPropertyFlags properties)
+{
+	createUnboundImage(width, height, mipLevelsIn, numSamples, format, tiling, usage);
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+	// lazily allocated memory is optional, fall back to plain device local memory where the device has none
+	uint32_t memoryType;
+	if (!hasMemoryType(memRequirements.memoryTypeBits, properties, &memoryType)) {
+		memoryType = findMemoryType(memRequirements.memoryTypeBits, properties & ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+	}
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memRequirements.size;
+	allocInfo.memoryTypeIndex = memoryType;
+
+	VULKAN_CHECK_RESULT(vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory), "Failed to allocate image memory!");
+
+	vkBindImageMemory(device, image, imageMemory, 0);
+}
+
+void VKImage::createUnboundImage(uint32_t width, uint32_t height, uint32_t mipLevelsIn, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling,
+	VkImageUsageFlags usage)
 {
 	mipLevels = mipLevelsIn;
 
@@ -74,18 +103,6 @@ void VKImage::createImage(uint32_t width, uint32_t height, uint32_t mipLevelsIn,
 	imageInfo.flags = 0;
 
 	VULKAN_CHECK_RESULT(vkCreateImage(device, &imageInfo, nullptr, &image), "Failed to create image!");
-
-	VkMemoryRequirements memRequirements;
-	vkGetImageMemoryRequirements(device, image, &memRequirements);
-
-	VkMemoryAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-	VULKAN_CHECK_RESULT(vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory), "Failed to allocate image memory!");
-
-	vkBindImageMemory(device, image, imageMemory, 0);
 }
 
 void VKImage::createImageView(VkFormat format, VkImageAspectFlags aspectFlags) {
@@ -110,25 +127,7 @@ VkImageView VKImage::createImageView(VkImage image, VkFormat format, VkImageAspe
 }
 
 void VKImage::createSampler() {
-	VkSamplerCreateInfo samplerInfo = {};
-	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-	samplerInfo.magFilter = VK_FILTER_LINEAR;
-	samplerInfo.minFilter = VK_FILTER_LINEAR;
-	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.anisotropyEnable = VK_TRUE;
-	samplerInfo.maxAnisotropy = 16;
-	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-	samplerInfo.unnormalizedCoordinates = VK_FALSE;
-	samplerInfo.compareEnable = VK_FALSE;
-	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-	samplerInfo.mipLodBias = 0.0f;
-	samplerInfo.minLod = 0;
-	samplerInfo.maxLod = static_cast<float>(mipLevels);
-
-	VULKAN_CHECK_RESULT(vkCreateSampler(device, &samplerInfo, nullptr, &sampler), "Failed to create texture sampler!");
+	sampler = VKSamplerCache::getSampler(VKSamplerCache::getTextureSamplerInfo());
 }
 
 VkSampleCountFlagBits VKImage::getMaxUsableSampleCount() {
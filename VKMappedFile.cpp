@@ -0,0 +1,144 @@
+#include "VKMappedFile.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	// the smallest page size of the platforms we run on, padding never reaches past it
+	const size_t MinPageSize = 4096;
+}
+
+VKMappedFile::VKMappedFile(const std::string& fileName) {
+	open(fileName);
+}
+
+VKMappedFile::VKMappedFile(VKMappedFile&& other) noexcept {
+	*this = std::move(other);
+}
+
+VKMappedFile& VKMappedFile::operator=(VKMappedFile&& other) noexcept {
+	if (this != &other) {
+		close();
+		std::swap(view, other.view);
+		std::swap(fileSize, other.fileSize);
+		std::swap(opened, other.opened);
+#ifdef _WIN32
+		std::swap(fileHandle, other.fileHandle);
+		std::swap(mappingHandle, other.mappingHandle);
+#endif
+	}
+	return *this;
+}
+
+VKMappedFile::~VKMappedFile() {
+	close();
+}
+
+void VKMappedFile::open(const std::string& fileName) {
+	if (!tryOpen(fileName)) {
+		throw std::runtime_error("Failed to open " + fileName + "!");
+	}
+}
+
+bool VKMappedFile::tryOpen(const std::string& fileName) {
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		CloseHandle(file);
+		return false;
+	}
+	fileHandle = file;
+	fileSize = static_cast<size_t>(size.QuadPart);
+	opened = true;
+
+	// an empty file can't be mapped, it is just empty
+	if (fileSize == 0) {
+		return true;
+	}
+
+	mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle != nullptr) {
+		view = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	}
+#else
+	int file = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+	if (file < 0) {
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(file, &info) != 0) {
+		::close(file);
+		return false;
+	}
+	fileSize = static_cast<size_t>(info.st_size);
+	opened = true;
+
+	if (fileSize != 0) {
+		void* mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, file, 0);
+		view = mapping != MAP_FAILED ? static_cast<const char*>(mapping) : nullptr;
+		if (view != nullptr) {
+			// loaders mostly read front to back
+			madvise(mapping, fileSize, MADV_SEQUENTIAL);
+		}
+	}
+	// the mapping keeps its own reference to the file
+	::close(file);
+#endif
+
+	if (fileSize != 0 && view == nullptr) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void VKMappedFile::close() {
+#ifdef _WIN32
+	if (view != nullptr) {
+		UnmapViewOfFile(view);
+	}
+	if (mappingHandle != nullptr) {
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle != nullptr) {
+		CloseHandle(fileHandle);
+	}
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	if (view != nullptr) {
+		munmap(const_cast<char*>(view), fileSize);
+	}
+#endif
+	view = nullptr;
+	fileSize = 0;
+	opened = false;
+}
+
+size_t VKMappedFile::getPaddedSize(size_t alignment) const {
+	// a size that isn't a multiple of alignment ends inside a page, so the padding stays in the mapping
+	if (alignment == 0 || alignment > MinPageSize || MinPageSize % alignment != 0) {
+		throw std::runtime_error("Unsupported padding alignment!");
+	}
+	return (fileSize + alignment - 1) / alignment * alignment;
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <streambuf>
+#include <cstdint>
+
+// Read-only memory mapping of a whole file, the pages are loaded on first touch and never copied
+// to the heap. The view starts on a page boundary, so its data is aligned for any element type,
+// and the rest of the last page reads as zeros.
+class VKMappedFile
+{
+public:
+	VKMappedFile(const VKMappedFile&) = delete;
+	VKMappedFile& operator=(const VKMappedFile&) = delete;
+	VKMappedFile() = default;
+	explicit VKMappedFile(const std::string& fileName);
+	VKMappedFile(VKMappedFile&& other) noexcept;
+	VKMappedFile& operator=(VKMappedFile&& other) noexcept;
+	~VKMappedFile();
+
+	// throws if the file can't be opened
+	void open(const std::string& fileName);
+	bool tryOpen(const std::string& fileName);
+	void close();
+
+	const char* data() const { return view; }
+	size_t size() const { return fileSize; }
+	bool isOpen() const { return opened; }
+
+	template<typename T>
+	const T* as() const { return reinterpret_cast<const T*>(view); }
+
+	// size rounded up to a multiple of alignment, at most a page; the bytes past size are the mapping's zeros
+	size_t getPaddedSize(size_t alignment) const;
+
+private:
+	const char* view = nullptr;
+	size_t fileSize = 0;
+	bool opened = false;
+
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
+
+// lets stream based loaders read a mapping without copying it
+class VKMemoryStreamBuffer : public std::streambuf
+{
+public:
+	VKMemoryStreamBuffer(const char* data, size_t size) {
+		char* begin = const_cast<char*>(data);
+		setg(begin, begin, begin + size);
+	}
+};
\ No newline at end of file
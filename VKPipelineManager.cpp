@@ -0,0 +1,492 @@
+#include "VKPipelineManager.h"
+#include "VKTimeline.h"
+#include "VKMappedFile.h"
+
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+VkDevice VKPipelineManager::device = nullptr;
+VkPhysicalDevice VKPipelineManager::physicalDevice = nullptr;
+
+size_t VKPipelineDesc::getHash() const {
+	size_t hash = std::hash<std::string>()(vertexShader);
+	auto combine = [&hash](size_t value) {
+		hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	};
+
+	combine(std::hash<std::string>()(fragmentShader));
+	for (const VkVertexInputBindingDescription& binding : vertexBindings) {
+		combine(binding.binding);
+		combine(binding.stride);
+		combine(binding.inputRate);
+	}
+	for (const VkVertexInputAttributeDescription& attribute : vertexAttributes) {
+		combine(attribute.location);
+		combine(attribute.binding);
+		combine(attribute.format);
+		combine(attribute.offset);
+	}
+	combine(std::hash<const void*>()(layout));
+	combine(std::hash<const void*>()(renderPass));
+	combine(subpass);
+	combine(cullMode);
+	combine(samples);
+	combine(sampleShading);
+	combine(std::hash<float>()(minSampleShading));
+	combine(depthWrite);
+	combine(depthCompare);
+	combine(colorWriteMask);
+	for (const auto& constant : specializationConstants) {
+		combine(constant.first);
+		combine(constant.second);
+	}
+	return hash;
+}
+
+bool VKPipelineDesc::operator==(const VKPipelineDesc& other) const {
+	auto sameBinding = [](const VkVertexInputBindingDescription& a, const VkVertexInputBindingDescription& b) {
+		return a.binding == b.binding && a.stride == b.stride && a.inputRate == b.inputRate;
+	};
+	auto sameAttribute = [](const VkVertexInputAttributeDescription& a, const VkVertexInputAttributeDescription& b) {
+		return a.location == b.location && a.binding == b.binding && a.format == b.format && a.offset == b.offset;
+	};
+
+	return vertexShader == other.vertexShader && fragmentShader == other.fragmentShader
+		&& std::equal(vertexBindings.begin(), vertexBindings.end(), other.vertexBindings.begin(), other.vertexBindings.end(), sameBinding)
+		&& std::equal(vertexAttributes.begin(), vertexAttributes.end(), other.vertexAttributes.begin(), other.vertexAttributes.end(), sameAttribute)
+		&& layout == other.layout && renderPass == other.renderPass && subpass == other.subpass
+		&& cullMode == other.cullMode && samples == other.samples
+		&& sampleShading == other.sampleShading && minSampleShading == other.minSampleShading
+		&& depthWrite == other.depthWrite && depthCompare == other.depthCompare
+		&& colorWriteMask == other.colorWriteMask && specializationConstants == other.specializationConstants;
+}
+
+void VKPipelineManager::initDevices(VkDevice deviceIn, VkPhysicalDevice physicalDeviceIn) {
+	device = deviceIn;
+	physicalDevice = physicalDeviceIn;
+}
+
+VKPipelineManager::~VKPipelineManager() {
+	destroy();
+}
+
+void VKPipelineManager::create(const std::string& cachePathIn, uint32_t workerCount) {
+	cachePath = cachePathIn;
+	loadCache();
+
+	stopping = false;
+	for (uint32_t i = 0; i < workerCount; i++) {
+		workers.emplace_back(&VKPipelineManager::workerLoop, this);
+	}
+}
+
+void VKPipelineManager::destroy() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		jobs.clear();
+	}
+	jobQueued.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+
+	clearPipelines();
+
+	if (pipelineCache != VK_NULL_HANDLE) {
+		saveCache();
+		vkDestroyPipelineCache(device, pipelineCache, nullptr);
+		pipelineCache = VK_NULL_HANDLE;
+	}
+}
+
+VkPipeline VKPipelineManager::getPipeline(const VKPipelineDesc& desc) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto found = pipelines.find(desc);
+	if (found != pipelines.end()) {
+		return found->second.pipeline;
+	}
+
+	// without workers it stays pending until someone asks for it with getPipelineNow
+	pipelines.emplace(desc, Entry());
+	jobs.push_back({ desc, false });
+	jobQueued.notify_one();
+	return VK_NULL_HANDLE;
+}
+
+VkPipeline VKPipelineManager::getPipelineNow(const VKPipelineDesc& desc) {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		auto found = pipelines.find(desc);
+		if (found == pipelines.end()) {
+			pipelines.emplace(desc, Entry());
+		}
+		else if (found->second.state == State::Ready) {
+			return found->second.pipeline;
+		}
+		else if (found->second.state == State::Pending) {
+			auto queued = std::find_if(jobs.begin(), jobs.end(), [&desc](const Job& job) {
+				return !job.reload && job.desc == desc;
+			});
+			if (queued != jobs.end()) {
+				// not picked up yet, take it over
+				jobs.erase(queued);
+			}
+			else {
+				// a worker is on it already
+				jobFinished.wait(lock, [&]() { return pipelines[desc].state != State::Pending; });
+				if (pipelines[desc].state == State::Ready) {
+					return pipelines[desc].pipeline;
+				}
+			}
+		}
+		// a failed pipeline is compiled again here so its error reaches the caller
+	}
+
+	VkPipeline pipeline;
+	try {
+		pipeline = compile(desc);
+	}
+	catch (...) {
+		finishJob({ desc, false }, State::Failed, VK_NULL_HANDLE, false);
+		throw;
+	}
+	finishJob({ desc, false }, State::Ready, pipeline, false);
+	return pipeline;
+}
+
+void VKPipelineManager::clearPipelines() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	// queued descriptions may reference a render pass about to be destroyed
+	jobs.clear();
+	jobFinished.wait(lock, [this]() { return activeJobs == 0; });
+
+	for (auto& entry : pipelines) {
+		if (entry.second.pipeline != VK_NULL_HANDLE) {
+			vkDestroyPipeline(device, entry.second.pipeline, nullptr);
+		}
+		if (entry.second.reloaded != VK_NULL_HANDLE) {
+			vkDestroyPipeline(device, entry.second.reloaded, nullptr);
+		}
+	}
+	pipelines.clear();
+}
+
+size_t VKPipelineManager::reloadShader(const std::string& fileName) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	size_t queued = 0;
+	for (auto& entry : pipelines) {
+		const VKPipelineDesc& desc = entry.first;
+		if (desc.vertexShader != fileName && desc.fragmentShader != fileName) {
+			continue;
+		}
+
+		if (entry.second.state == State::Failed) {
+			// the change may have fixed it, compile it like a new pipeline
+			entry.second.state = State::Pending;
+			jobs.push_back({ desc, false });
+			queued++;
+			continue;
+		}
+		if (entry.second.state == State::Pending) {
+			// its compile hasn't finished, or hasn't started, and reads the file again anyway
+			continue;
+		}
+
+		bool alreadyQueued = std::any_of(jobs.begin(), jobs.end(), [&desc](const Job& job) {
+			return job.reload && job.desc == desc;
+		});
+		if (!alreadyQueued) {
+			jobs.push_back({ desc, true });
+			queued++;
+		}
+	}
+
+	jobQueued.notify_all();
+	return queued;
+}
+
+size_t VKPipelineManager::swapReloadedPipelines() {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	size_t swapped = 0;
+	for (auto& entry : pipelines) {
+		if (entry.second.reloaded == VK_NULL_HANDLE) {
+			continue;
+		}
+
+		VkPipeline old = entry.second.pipeline;
+		VkDevice deviceCopy = device;
+		VKTimeline::deferDestroy([deviceCopy, old]() {
+			vkDestroyPipeline(deviceCopy, old, nullptr);
+		});
+
+		entry.second.pipeline = entry.second.reloaded;
+		entry.second.reloaded = VK_NULL_HANDLE;
+		swapped++;
+	}
+	return swapped;
+}
+
+size_t VKPipelineManager::getPendingCount() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return jobs.size() + activeJobs;
+}
+
+void VKPipelineManager::workerLoop() {
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobQueued.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (stopping) {
+				return;
+			}
+			job = jobs.front();
+			jobs.pop_front();
+			activeJobs++;
+		}
+
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		State state = State::Ready;
+		try {
+			pipeline = compile(job.desc);
+		}
+		catch (const std::exception& e) {
+			std::cerr << "Pipeline compile failed: " << e.what() << std::endl;
+			state = State::Failed;
+		}
+
+		finishJob(job, state, pipeline, true);
+	}
+}
+
+void VKPipelineManager::finishJob(const Job& job, State state, VkPipeline pipeline, bool fromWorker) {
+	{
+		// in the same lock as the store, so clearPipelines can't miss a pipeline that is being finished
+		std::lock_guard<std::mutex> lock(mutex);
+		if (fromWorker) {
+			activeJobs--;
+		}
+
+		Entry& entry = pipelines[job.desc];
+		if (!job.reload) {
+			entry.state = state;
+			entry.pipeline = pipeline;
+		}
+		else if (state == State::Ready) {
+			// a failed reload keeps the working pipeline
+			if (entry.reloaded != VK_NULL_HANDLE) {
+				vkDestroyPipeline(device, entry.reloaded, nullptr);
+			}
+			entry.reloaded = pipeline;
+		}
+	}
+	jobFinished.notify_all();
+}
+
+VkPipeline VKPipelineManager::compile(const VKPipelineDesc& desc) {
+	// modules are only needed while the pipeline is created
+	std::vector<VkShaderModule> modules;
+	std::vector<VkPipelineShaderStageCreateInfo> stages;
+
+	std::vector<VkSpecializationMapEntry> specializationEntries;
+	std::vector<uint32_t> specializationData;
+	for (const auto& constant : desc.specializationConstants) {
+		VkSpecializationMapEntry entry = {};
+		entry.constantID = constant.first;
+		entry.offset = static_cast<uint32_t>(specializationData.size() * sizeof(uint32_t));
+		entry.size = sizeof(uint32_t);
+		specializationEntries.push_back(entry);
+		specializationData.push_back(constant.second);
+	}
+
+	VkSpecializationInfo specializationInfo = {};
+	specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationEntries.size());
+	specializationInfo.pMapEntries = specializationEntries.data();
+	specializationInfo.dataSize = specializationData.size() * sizeof(uint32_t);
+	specializationInfo.pData = specializationData.data();
+
+	auto addStage = [&](VkShaderStageFlagBits stage, const std::string& fileName) {
+		modules.push_back(loadShader(fileName));
+
+		VkPipelineShaderStageCreateInfo stageInfo = {};
+		stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stageInfo.stage = stage;
+		stageInfo.module = modules.back();
+		stageInfo.pName = "main";
+		stageInfo.pSpecializationInfo = specializationEntries.empty() ? nullptr : &specializationInfo;
+		stages.push_back(stageInfo);
+	};
+
+	auto destroyModules = [&]() {
+		for (VkShaderModule module : modules) {
+			vkDestroyShaderModule(device, module, nullptr);
+		}
+	};
+
+	try {
+		addStage(VK_SHADER_STAGE_VERTEX_BIT, desc.vertexShader);
+		// no fragment shader, the depth test alone writes the depth buffer
+		if (!desc.fragmentShader.empty()) {
+			addStage(VK_SHADER_STAGE_FRAGMENT_BIT, desc.fragmentShader);
+		}
+	}
+	catch (...) {
+		destroyModules();
+		throw;
+	}
+
+	VkPipelineVertexInputStateCreateInfo vertexInputState = {};
+	vertexInputState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputState.vertexBindingDescriptionCount = static_cast<uint32_t>(desc.vertexBindings.size());
+	vertexInputState.vertexAttributeDescriptionCount = static_cast<uint32_t>(desc.vertexAttributes.size());
+	vertexInputState.pVertexBindingDescriptions = desc.vertexBindings.data();
+	vertexInputState.pVertexAttributeDescriptions = desc.vertexAttributes.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = {};
+	inputAssemblyState.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssemblyState.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssemblyState.primitiveRestartEnable = VK_FALSE;
+
+	// viewport and scissor follow the render resolution, which changes without rebuilding the pipeline
+	VkPipelineViewportStateCreateInfo viewportState = {};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.pViewports = nullptr;
+	viewportState.scissorCount = 1;
+	viewportState.pScissors = nullptr;
+
+	VkPipelineRasterizationStateCreateInfo rasterizationState = {};
+	rasterizationState.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizationState.depthClampEnable = VK_FALSE;
+	rasterizationState.rasterizerDiscardEnable = VK_FALSE;
+	rasterizationState.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizationState.cullMode = desc.cullMode;
+	rasterizationState.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	rasterizationState.lineWidth = 1.f;
+	rasterizationState.depthBiasEnable = VK_FALSE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling = {};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.rasterizationSamples = desc.samples;
+	multisampling.sampleShadingEnable = desc.sampleShading ? VK_TRUE : VK_FALSE;
+	multisampling.minSampleShading = desc.minSampleShading;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = desc.depthWrite ? VK_TRUE : VK_FALSE;
+	depthStencil.depthCompareOp = desc.depthCompare;
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.minDepthBounds = 0.0f;
+	depthStencil.maxDepthBounds = 1.0f;
+	depthStencil.stencilTestEnable = VK_FALSE;
+
+	VkPipelineColorBlendAttachmentState blendAttachment = {};
+	blendAttachment.blendEnable = VK_FALSE;
+	blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+	blendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	blendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+	blendAttachment.colorWriteMask = desc.colorWriteMask;
+
+	VkPipelineColorBlendStateCreateInfo blendState = {};
+	blendState.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	blendState.logicOpEnable = VK_FALSE;
+	blendState.logicOp = VK_LOGIC_OP_COPY;
+	blendState.attachmentCount = 1;
+	blendState.pAttachments = &blendAttachment;
+
+	VkDynamicState dynamicStates[] = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+
+	VkPipelineDynamicStateCreateInfo dynamicState = {};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
+
+	VkGraphicsPipelineCreateInfo info = {};
+	info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	info.stageCount = static_cast<uint32_t>(stages.size());
+	info.pStages = stages.data();
+	info.pVertexInputState = &vertexInputState;
+	info.pInputAssemblyState = &inputAssemblyState;
+	info.pTessellationState = nullptr;
+	info.pViewportState = &viewportState;
+	info.pRasterizationState = &rasterizationState;
+	info.pMultisampleState = &multisampling;
+	info.pDepthStencilState = &depthStencil;
+	info.pColorBlendState = &blendState;
+	info.pDynamicState = &dynamicState;
+	info.layout = desc.layout;
+	info.renderPass = desc.renderPass;
+	info.subpass = desc.subpass;
+
+	// pipeline caches are synchronized internally, so every worker can use the same one
+	VkPipeline pipeline;
+	VkResult result = vkCreateGraphicsPipelines(device, pipelineCache, 1, &info, nullptr, &pipeline);
+	destroyModules();
+	VULKAN_CHECK_RESULT(result, "Failed to create graphics pipeline!");
+	return pipeline;
+}
+
+void VKPipelineManager::loadCache() {
+	VKMappedFile file;
+	file.tryOpen(cachePath);
+	const char* data = file.data();
+	size_t size = file.size();
+
+	// header: length, version, vendor id, device id, pipeline cache uuid
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	bool valid = size >= 16 + VK_UUID_SIZE;
+	if (valid) {
+		uint32_t header[4];
+		memcpy(header, data, sizeof(header));
+		valid = header[0] >= 16 + VK_UUID_SIZE && header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+			&& header[2] == properties.vendorID && header[3] == properties.deviceID
+			&& memcmp(data + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+	if (!valid) {
+		// another device or driver wrote it, start empty
+		size = 0;
+	}
+
+	// the driver copies what it keeps, the mapping is only needed during the call
+	VkPipelineCacheCreateInfo info = {};
+	info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	info.initialDataSize = size;
+	info.pInitialData = size != 0 ? data : nullptr;
+
+	VULKAN_CHECK_RESULT(vkCreatePipelineCache(device, &info, nullptr, &pipelineCache), "Failed to create pipeline cache!");
+
+	std::cout << "Pipeline cache: " << (valid ? "loaded " + std::to_string(size) + " bytes" : "empty") << std::endl;
+}
+
+void VKPipelineManager::saveCache() {
+	size_t size = 0;
+	if (vkGetPipelineCacheData(device, pipelineCache, &size, nullptr) != VK_SUCCESS || size == 0) {
+		return;
+	}
+
+	std::vector<char> data(size);
+	if (vkGetPipelineCacheData(device, pipelineCache, &size, data.data()) != VK_SUCCESS) {
+		return;
+	}
+
+	std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+	file.write(data.data(), size);
+}
\ No newline at end of file
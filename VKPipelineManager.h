@@ -0,0 +1,122 @@
+#pragma once
+
+#include "VulkanContext.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// everything a graphics pipeline is built from, equal descriptions share one pipeline
+struct VKPipelineDesc {
+	std::string vertexShader;
+	// empty for depth only pipelines
+	std::string fragmentShader;
+	std::vector<VkVertexInputBindingDescription> vertexBindings;
+	std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	uint32_t subpass = 0;
+
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+	bool sampleShading = false;
+	float minSampleShading = 0.f;
+	bool depthWrite = true;
+	VkCompareOp depthCompare = VK_COMPARE_OP_LESS;
+	VkColorComponentFlags colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+	// constant id and 32 bit value, applied to every stage
+	std::vector<std::pair<uint32_t, uint32_t>> specializationConstants;
+
+	size_t getHash() const;
+	bool operator==(const VKPipelineDesc& other) const;
+};
+
+// Graphics pipelines by description. Missing pipelines are compiled by worker threads while the
+// renderer keeps drawing with what is ready, so new variants never stall a frame. All pipelines
+// go through one VkPipelineCache that is loaded from and written back to disk.
+class VKPipelineManager
+{
+public:
+	static void initDevices(VkDevice device, VkPhysicalDevice physicalDevice);
+
+	VKPipelineManager(const VKPipelineManager&) = delete;
+	VKPipelineManager() = default;
+	~VKPipelineManager();
+
+	// reuses the cache file if this device wrote it, and starts the compile threads
+	void create(const std::string& cachePath, uint32_t workerCount);
+	// stops the workers, writes the cache back and destroys every pipeline
+	void destroy();
+
+	// the pipeline when it's ready, VK_NULL_HANDLE while it compiles in the background or if it failed
+	VkPipeline getPipeline(const VKPipelineDesc& desc);
+	// compiles on the calling thread if needed, for pipelines the renderer can't draw without
+	VkPipeline getPipelineNow(const VKPipelineDesc& desc);
+	// drops queued compiles and destroys every pipeline, none may be in use; their binaries stay in the cache
+	void clearPipelines();
+
+	// recompiles every pipeline that uses the shader in the background, returns how many were queued;
+	// until swapReloadedPipelines the old pipelines stay in use
+	size_t reloadShader(const std::string& fileName);
+	// replaces pipelines with their finished recompiles, call between frames; old ones are destroyed
+	// once the frames using them have completed
+	size_t swapReloadedPipelines();
+
+	size_t getPendingCount() const;
+	VkPipelineCache getPipelineCache() const { return pipelineCache; }
+
+	// creates a shader module from a file, called from the worker threads
+	std::function<VkShaderModule(const std::string&)> loadShader;
+
+private:
+	enum class State {
+		Pending,
+		Ready,
+		Failed
+	};
+
+	struct Entry {
+		State state = State::Pending;
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		// recompiled after a shader change, waiting to replace pipeline
+		VkPipeline reloaded = VK_NULL_HANDLE;
+	};
+
+	struct Job {
+		VKPipelineDesc desc;
+		bool reload;
+	};
+
+	struct DescHash {
+		size_t operator()(const VKPipelineDesc& desc) const { return desc.getHash(); }
+	};
+
+	VkPipeline compile(const VKPipelineDesc& desc);
+	void workerLoop();
+	void finishJob(const Job& job, State state, VkPipeline pipeline, bool fromWorker);
+	void loadCache();
+	void saveCache();
+
+	std::unordered_map<VKPipelineDesc, Entry, DescHash> pipelines;
+	std::deque<Job> jobs;
+	size_t activeJobs = 0;
+	bool stopping = false;
+
+	std::vector<std::thread> workers;
+	mutable std::mutex mutex;
+	std::condition_variable jobQueued;
+	std::condition_variable jobFinished;
+
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+	std::string cachePath;
+
+	static VkDevice device;
+	static VkPhysicalDevice physicalDevice;
+};
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "VKQuality.h"
+
+#include <cstring>
+
+VKQuality::VKQuality() {
+	setTier(QualityTier::Ultra);
+}
+
+void VKQuality::setTier(QualityTier tierIn) {
+	tier = tierIn;
+
+	switch (tier) {
+	case QualityTier::Low:
+		requestedSamples = VK_SAMPLE_COUNT_1_BIT;
+		sampleShading = false;
+		minSampleShading = 0.f;
+		break;
+	case QualityTier::Medium:
+		requestedSamples = VK_SAMPLE_COUNT_4_BIT;
+		sampleShading = false;
+		minSampleShading = 0.f;
+		break;
+	case QualityTier::High:
+		requestedSamples = VK_SAMPLE_COUNT_8_BIT;
+		sampleShading = true;
+		minSampleShading = .2f;
+		break;
+	case QualityTier::Ultra:
+		requestedSamples = VK_SAMPLE_COUNT_64_BIT;
+		sampleShading = true;
+		minSampleShading = .2f;
+		break;
+	}
+}
+
+QualityTier VKQuality::getNextTier(QualityTier tier) {
+	return tier == QualityTier::Ultra ? QualityTier::Low : static_cast<QualityTier>(static_cast<int>(tier) + 1);
+}
+
+const char* VKQuality::getTierName() const {
+	switch (tier) {
+	case QualityTier::Low:
+		return "low";
+	case QualityTier::Medium:
+		return "medium";
+	case QualityTier::High:
+		return "high";
+	default:
+		return "ultra";
+	}
+}
+
+bool VKQuality::parseTier(const char* name, QualityTier* tierOut) {
+	const char* names[] = { "low", "medium", "high", "ultra" };
+	for (int i = 0; i < 4; i++) {
+		if (strcmp(name, names[i]) == 0) {
+			*tierOut = static_cast<QualityTier>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+VkSampleCountFlagBits VKQuality::getSamples() const {
+	// sample counts are single bits, so the largest supported one not above the request wins
+	uint32_t samples = requestedSamples;
+	while (samples > maxSamples) {
+		samples >>= 1;
+	}
+	return static_cast<VkSampleCountFlagBits>(samples);
+}
\ No newline at end of file
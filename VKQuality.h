@@ -0,0 +1,38 @@
+#pragma once
+
+#include "VulkanContext.h"
+
+enum class QualityTier {
+	Low,
+	Medium,
+	High,
+	Ultra
+};
+
+// Anti-aliasing cost per tier: sample count of the color/depth attachments, per-sample shading
+// and how the result reaches the swapchain. Low renders straight into the swapchain image,
+// every other tier renders multisampled and resolves at the end of the render pass.
+class VKQuality
+{
+public:
+	VKQuality();
+
+	void setTier(QualityTier tier);
+	QualityTier getTier() const { return tier; }
+	static QualityTier getNextTier(QualityTier tier);
+	const char* getTierName() const;
+	static bool parseTier(const char* name, QualityTier* tier);
+
+	// requested sample count clamped to what the device supports
+	VkSampleCountFlagBits getSamples() const;
+	bool resolves() const { return getSamples() != VK_SAMPLE_COUNT_1_BIT; }
+
+	VkSampleCountFlagBits maxSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	bool sampleShading = false;
+	float minSampleShading = 0.f;
+
+private:
+	QualityTier tier;
+	VkSampleCountFlagBits requestedSamples = VK_SAMPLE_COUNT_1_BIT;
+};
\ No newline at end of file
@@ -0,0 +1,269 @@
+#include "VKRenderGraph.h"
+
+const VKUsageInfo& VKRenderGraph::getUsageInfo(VKResourceUsage usage) {
+	static const VKUsageInfo usageInfos[] = {
+		// None
+		{ VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, 0, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED },
+		// Transfer
+		{ VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL },
+		// IndirectCommand
+		{ VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED },
+		// VertexInput
+		{ VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT, 0,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED },
+		// VertexShader
+		{ VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL },
+		// FragmentShader
+		{ VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL },
+		// ComputeShader
+		{ VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL },
+		// ColorAttachment
+		{ VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+		// DepthAttachment
+		{ VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL },
+		// Present
+		{ VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR }
+	};
+
+	return usageInfos[static_cast<size_t>(usage)];
+}
+
+VKResourceUsage VKRenderGraph::getLayoutUsage(VkImageLayout layout) {
+	switch (layout) {
+	case VK_IMAGE_LAYOUT_UNDEFINED:
+		return VKResourceUsage::None;
+	case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+		return VKResourceUsage::Transfer;
+	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+		return VKResourceUsage::FragmentShader;
+	case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+		return VKResourceUsage::ColorAttachment;
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+		return VKResourceUsage::DepthAttachment;
+	case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+		return VKResourceUsage::Present;
+	default:
+		throw std::runtime_error("Unsupported layout transition!");
+	}
+}
+
+VKRenderGraph::Pass& VKRenderGraph::Pass::read(Resource resource, VKResourceUsage usage) {
+	getUse(resource, usage).read = true;
+	return *this;
+}
+
+VKRenderGraph::Pass& VKRenderGraph::Pass::write(Resource resource, VKResourceUsage usage) {
+	getUse(resource, usage).write = true;
+	return *this;
+}
+
+VKRenderGraph::Pass& VKRenderGraph::Pass::sideEffect() {
+	hasSideEffect = true;
+	return *this;
+}
+
+VKRenderGraph::Pass::Use& VKRenderGraph::Pass::getUse(Resource resource, VKResourceUsage usage) {
+	for (Use& use : uses) {
+		if (use.resource == resource) {
+			CHECK_RESULT((use.usage == usage), "Resource used twice with different usages in pass " + name + "!");
+			return use;
+		}
+	}
+	uses.push_back({ resource, usage, false, false });
+	return uses.back();
+}
+
+void VKRenderGraph::reset() {
+	resources.clear();
+	passes.clear();
+}
+
+VKRenderGraph::Resource VKRenderGraph::importImage(VkImage image, VkImageAspectFlags aspectMask, uint32_t mipLevels, VkImageLayout initialLayout,
+	VKResourceUsage previousUsage, VkImageLayout finalLayout) {
+	ResourceState state;
+	state.image = image;
+	state.aspectMask = aspectMask;
+	state.mipLevels = mipLevels;
+	state.initialLayout = initialLayout;
+	state.previousUsage = previousUsage;
+	state.finalLayout = finalLayout;
+	state.output = finalLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+
+	resources.push_back(state);
+	return static_cast<Resource>(resources.size() - 1);
+}
+
+VKRenderGraph::Resource VKRenderGraph::importBuffer(VkBuffer buffer, VKResourceUsage previousUsage) {
+	ResourceState state;
+	state.buffer = buffer;
+	state.previousUsage = previousUsage;
+
+	resources.push_back(state);
+	return static_cast<Resource>(resources.size() - 1);
+}
+
+void VKRenderGraph::markOutput(Resource resource) {
+	resources[resource].output = true;
+}
+
+VKRenderGraph::Pass& VKRenderGraph::addPass(const std::string& name, std::function<void(VkCommandBuffer)> record) {
+	passes.emplace_back();
+	passes.back().name = name;
+	passes.back().record = record;
+	return passes.back();
+}
+
+void VKRenderGraph::cullPasses() {
+	std::vector<bool> needed(resources.size());
+	for (size_t i = 0; i < resources.size(); i++) {
+		needed[i] = resources[i].output;
+	}
+
+	for (size_t i = passes.size(); i-- > 0;) {
+		Pass& pass = passes[i];
+
+		bool live = pass.hasSideEffect;
+		for (const Pass::Use& use : pass.uses) {
+			live = live || (use.write && needed[use.resource]);
+		}
+
+		pass.culled = !live;
+		if (live) {
+			for (const Pass::Use& use : pass.uses) {
+				if (use.read) {
+					needed[use.resource] = true;
+				}
+			}
+		}
+	}
+}
+
+void VKRenderGraph::addBarrier(Pass& pass, ResourceState& state, const VKUsageInfo& info, bool read, bool write) {
+	VkAccessFlags access = (read ? info.readAccess : 0) | (write ? info.writeAccess : 0);
+	VkImageLayout layout = write ? info.writeLayout : info.readLayout;
+	bool layoutChange = state.image != VK_NULL_HANDLE && layout != state.layout;
+
+	if (!write && !layoutChange) {
+		// read after read needs nothing, read after write only once per stage
+		state.readStages |= info.stage;
+		if (state.writeStage == 0 || (state.visibleStages & info.stage) == info.stage) {
+			return;
+		}
+
+		pass.srcStage |= state.writeStage;
+		pass.dstStage |= info.stage;
+		pass.memoryBarrier.srcAccessMask |= state.writeAccess;
+		pass.memoryBarrier.dstAccessMask |= access;
+		state.visibleStages |= info.stage;
+		return;
+	}
+
+	VkPipelineStageFlags srcStage = state.writeStage | state.readStages;
+	pass.srcStage |= srcStage ? srcStage : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	pass.dstStage |= info.stage;
+
+	if (layoutChange) {
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = state.writeAccess;
+		barrier.dstAccessMask = access;
+		barrier.oldLayout = state.layout;
+		barrier.newLayout = layout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = state.image;
+		barrier.subresourceRange.aspectMask = state.aspectMask;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = state.mipLevels;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+		pass.imageBarriers.push_back(barrier);
+
+		state.layout = layout;
+	}
+	else {
+		pass.memoryBarrier.srcAccessMask |= state.writeAccess;
+		pass.memoryBarrier.dstAccessMask |= access;
+	}
+
+	// a layout transition is a write as far as later uses are concerned
+	state.writeStage = info.stage;
+	state.writeAccess = write ? info.writeAccess : 0;
+	state.visibleStages = info.stage;
+	state.readStages = read ? info.stage : 0;
+}
+
+void VKRenderGraph::compile() {
+	cullPasses();
+
+	for (ResourceState& state : resources) {
+		const VKUsageInfo& previous = getUsageInfo(state.previousUsage);
+		state.layout = state.initialLayout;
+		state.writeStage = state.previousUsage == VKResourceUsage::None ? 0 : previous.stage;
+		state.writeAccess = previous.writeAccess;
+		state.visibleStages = 0;
+		state.readStages = 0;
+	}
+
+	for (Pass& pass : passes) {
+		if (pass.culled) {
+			continue;
+		}
+
+		pass.memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		for (const Pass::Use& use : pass.uses) {
+			addBarrier(pass, resources[use.resource], getUsageInfo(use.usage), use.read, use.write);
+		}
+	}
+
+	finalPass = Pass();
+	finalPass.memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	for (ResourceState& state : resources) {
+		if (state.image != VK_NULL_HANDLE && state.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED && state.finalLayout != state.layout) {
+			VKUsageInfo info = { VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, state.finalLayout, state.finalLayout };
+			addBarrier(finalPass, state, info, true, false);
+		}
+	}
+}
+
+void VKRenderGraph::recordBarriers(VkCommandBuffer commandBuffer, Pass& pass) {
+	if (pass.srcStage == 0 && pass.imageBarriers.empty()) {
+		return;
+	}
+
+	bool hasMemoryBarrier = pass.memoryBarrier.srcAccessMask != 0 || pass.memoryBarrier.dstAccessMask != 0;
+	vkCmdPipelineBarrier(commandBuffer, pass.srcStage, pass.dstStage, 0,
+		hasMemoryBarrier ? 1 : 0, hasMemoryBarrier ? &pass.memoryBarrier : nullptr,
+		0, nullptr,
+		static_cast<uint32_t>(pass.imageBarriers.size()), pass.imageBarriers.data());
+}
+
+void VKRenderGraph::execute(VkCommandBuffer commandBuffer) {
+	for (Pass& pass : passes) {
+		if (pass.culled) {
+			continue;
+		}
+
+		recordBarriers(commandBuffer, pass);
+		pass.record(commandBuffer);
+	}
+
+	recordBarriers(commandBuffer, finalPass);
+}
+
+uint32_t VKRenderGraph::getCulledPassCount() const {
+	uint32_t count = 0;
+	for (const Pass& pass : passes) {
+		count += pass.culled ? 1 : 0;
+	}
+	return count;
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "VulkanContext.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// where in the frame a resource is touched; read/write on a pass picks the access bits and layout
+enum class VKResourceUsage {
+	None,
+	Transfer,
+	IndirectCommand,
+	VertexInput,
+	VertexShader,
+	FragmentShader,
+	ComputeShader,
+	ColorAttachment,
+	DepthAttachment,
+	Present
+};
+
+struct VKUsageInfo {
+	VkPipelineStageFlags stage;
+	VkAccessFlags readAccess;
+	VkAccessFlags writeAccess;
+	VkImageLayout readLayout;
+	VkImageLayout writeLayout;
+};
+
+// Per-frame graph of passes. Passes declare the images and buffers they read and write,
+// compile() drops passes whose results nobody consumes and derives one batched
+// vkCmdPipelineBarrier per pass from the declared usages, execute() records everything.
+class VKRenderGraph
+{
+public:
+	typedef uint32_t Resource;
+
+	class Pass {
+	public:
+		Pass& read(Resource resource, VKResourceUsage usage);
+		Pass& write(Resource resource, VKResourceUsage usage);
+		// keep the pass even if none of its writes are consumed
+		Pass& sideEffect();
+
+	private:
+		friend class VKRenderGraph;
+
+		struct Use {
+			Resource resource;
+			VKResourceUsage usage;
+			bool read;
+			bool write;
+		};
+
+		Use& getUse(Resource resource, VKResourceUsage usage);
+
+		std::string name;
+		std::function<void(VkCommandBuffer)> record;
+		std::vector<Use> uses;
+		bool hasSideEffect = false;
+		bool culled = false;
+
+		VkPipelineStageFlags srcStage = 0;
+		VkPipelineStageFlags dstStage = 0;
+		VkMemoryBarrier memoryBarrier = {};
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+	};
+
+	static const VKUsageInfo& getUsageInfo(VKResourceUsage usage);
+	// stage and access of the usage a layout implies, for one-off transitions outside a graph
+	static VKResourceUsage getLayoutUsage(VkImageLayout layout);
+
+	void reset();
+
+	// previousUsage is how earlier submissions touched the resource, the first use waits for it;
+	// finalLayout, when set, is the layout the image is left in and makes it an output of the graph
+	Resource importImage(VkImage image, VkImageAspectFlags aspectMask, uint32_t mipLevels, VkImageLayout initialLayout,
+		VKResourceUsage previousUsage = VKResourceUsage::None, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+	Resource importBuffer(VkBuffer buffer, VKResourceUsage previousUsage = VKResourceUsage::None);
+	void markOutput(Resource resource);
+
+	Pass& addPass(const std::string& name, std::function<void(VkCommandBuffer)> record);
+
+	void compile();
+	void execute(VkCommandBuffer commandBuffer);
+
+	uint32_t getCulledPassCount() const;
+
+private:
+	struct ResourceState {
+		VkImage image = VK_NULL_HANDLE;
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkImageAspectFlags aspectMask = 0;
+		uint32_t mipLevels = 1;
+
+		VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VKResourceUsage previousUsage = VKResourceUsage::None;
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		bool output = false;
+
+		// last write, stages that already see it and stages that read since
+		VkPipelineStageFlags writeStage = 0;
+		VkAccessFlags writeAccess = 0;
+		VkPipelineStageFlags visibleStages = 0;
+		VkPipelineStageFlags readStages = 0;
+	};
+
+	void cullPasses();
+	void addBarrier(Pass& pass, ResourceState& state, const VKUsageInfo& info, bool read, bool write);
+	void recordBarriers(VkCommandBuffer commandBuffer, Pass& pass);
+
+	std::vector<ResourceState> resources;
+	std::vector<Pass> passes;
+	// transitions of imported images into their final layouts after the last pass
+	Pass finalPass;
+};
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "VKRenderPassBuilder.h"
+
+uint32_t VKRenderPassBuilder::addColorAttachment(VkFormat format, VkSampleCountFlagBits samples, AttachmentInput input, AttachmentConsumer consumer) {
+	uint32_t index = addAttachment(format, samples, input, consumer, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	colorReferences.push_back({ index, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
+	resolveReferences.push_back({ VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED });
+	return index;
+}
+
+uint32_t VKRenderPassBuilder::addDepthAttachment(VkFormat format, VkSampleCountFlagBits samples, AttachmentInput input, AttachmentConsumer consumer) {
+	uint32_t index = addAttachment(format, samples, input, consumer, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+	depthReference = { index, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+	hasDepth = true;
+	return index;
+}
+
+uint32_t VKRenderPassBuilder::addResolveAttachment(uint32_t colorAttachment, VkFormat format, AttachmentConsumer consumer) {
+	uint32_t index = addAttachment(format, VK_SAMPLE_COUNT_1_BIT, AttachmentInput::Overwritten, consumer, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	for (size_t i = 0; i < colorReferences.size(); i++) {
+		if (colorReferences[i].attachment == colorAttachment) {
+			resolveReferences[i] = { index, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		}
+	}
+	return index;
+}
+
+uint32_t VKRenderPassBuilder::addAttachment(VkFormat format, VkSampleCountFlagBits samples, AttachmentInput input, AttachmentConsumer consumer, VkImageLayout layout) {
+	// attachments stay in their attachment layouts, the render graph transitions and synchronizes them around the pass
+	VkAttachmentDescription attachment = {};
+	attachment.format = format;
+	attachment.samples = samples;
+	attachment.loadOp = getLoadOp(input);
+	attachment.storeOp = getStoreOp(consumer);
+	attachment.stencilLoadOp = hasStencil(format) ? attachment.loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachment.stencilStoreOp = hasStencil(format) ? attachment.storeOp : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachment.initialLayout = layout;
+	attachment.finalLayout = layout;
+
+	attachments.push_back(attachment);
+	return static_cast<uint32_t>(attachments.size() - 1);
+}
+
+VkRenderPass VKRenderPassBuilder::build(VkDevice device) {
+	bool hasResolve = false;
+	for (const VkAttachmentReference& reference : resolveReferences) {
+		hasResolve = hasResolve || reference.attachment != VK_ATTACHMENT_UNUSED;
+	}
+
+	VkSubpassDescription subpassInfo = {};
+	subpassInfo.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpassInfo.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
+	subpassInfo.pColorAttachments = colorReferences.data();
+	subpassInfo.pDepthStencilAttachment = hasDepth ? &depthReference : nullptr;
+	subpassInfo.pResolveAttachments = hasResolve ? resolveReferences.data() : nullptr;
+
+	VkRenderPassCreateInfo info = {};
+	info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	info.attachmentCount = static_cast<uint32_t>(attachments.size());
+	info.pAttachments = attachments.data();
+	info.subpassCount = 1;
+	info.pSubpasses = &subpassInfo;
+	info.dependencyCount = 0;
+	info.pDependencies = nullptr;
+
+	VkRenderPass renderPass;
+	VULKAN_CHECK_RESULT(vkCreateRenderPass(device, &info, nullptr, &renderPass), "Failed to create render pass!");
+	return renderPass;
+}
+
+VkDeviceSize VKRenderPassBuilder::getBandwidth(VkExtent2D extent) const {
+	VkDeviceSize bytes = 0;
+	for (const VkAttachmentDescription& attachment : attachments) {
+		VkDeviceSize size = VkDeviceSize(extent.width) * extent.height * attachment.samples * getFormatSize(attachment.format);
+		if (attachment.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD) {
+			bytes += size;
+		}
+		if (attachment.storeOp == VK_ATTACHMENT_STORE_OP_STORE) {
+			bytes += size;
+		}
+	}
+	return bytes;
+}
+
+VkAttachmentLoadOp VKRenderPassBuilder::getLoadOp(AttachmentInput input) {
+	switch (input) {
+	case AttachmentInput::Cleared:
+		return VK_ATTACHMENT_LOAD_OP_CLEAR;
+	case AttachmentInput::Loaded:
+		return VK_ATTACHMENT_LOAD_OP_LOAD;
+	default:
+		return VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	}
+}
+
+VkAttachmentStoreOp VKRenderPassBuilder::getStoreOp(AttachmentConsumer consumer) {
+	// a resolved attachment is consumed inside the pass, nothing reads it back from memory
+	switch (consumer) {
+	case AttachmentConsumer::Presented:
+	case AttachmentConsumer::SampledLater:
+		return VK_ATTACHMENT_STORE_OP_STORE;
+	default:
+		return VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	}
+}
+
+uint32_t VKRenderPassBuilder::getFormatSize(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_D16_UNORM:
+		return 2;
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return 5;
+	case VK_FORMAT_R16G16B16A16_SFLOAT:
+		return 8;
+	default:
+		return 4;
+	}
+}
+
+bool VKRenderPassBuilder::hasStencil(VkFormat format) {
+	return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "VulkanContext.h"
+
+#include <vector>
+
+// what the pass finds in an attachment when it begins
+enum class AttachmentInput {
+	Cleared,
+	Loaded,
+	// every pixel gets written, e.g. a resolve target
+	Overwritten
+};
+
+// who needs the contents once the pass ends
+enum class AttachmentConsumer {
+	Discarded,
+	Resolved,
+	Presented,
+	SampledLater
+};
+
+// Single-subpass render pass whose load/store ops are derived from how each attachment is
+// produced and consumed instead of spelled out, plus the attachment memory traffic that implies.
+class VKRenderPassBuilder
+{
+public:
+	uint32_t addColorAttachment(VkFormat format, VkSampleCountFlagBits samples, AttachmentInput input, AttachmentConsumer consumer);
+	uint32_t addDepthAttachment(VkFormat format, VkSampleCountFlagBits samples, AttachmentInput input, AttachmentConsumer consumer);
+	// resolves a multisampled color attachment into a single sample one
+	uint32_t addResolveAttachment(uint32_t colorAttachment, VkFormat format, AttachmentConsumer consumer);
+
+	VkRenderPass build(VkDevice device);
+
+	// bytes loaded and stored per frame for the given extent; cleared or discarded contents cost nothing
+	VkDeviceSize getBandwidth(VkExtent2D extent) const;
+
+	const std::vector<VkAttachmentDescription>& getAttachments() const { return attachments; }
+
+private:
+	static VkAttachmentLoadOp getLoadOp(AttachmentInput input);
+	static VkAttachmentStoreOp getStoreOp(AttachmentConsumer consumer);
+	static uint32_t getFormatSize(VkFormat format);
+	static bool hasStencil(VkFormat format);
+
+	uint32_t addAttachment(VkFormat format, VkSampleCountFlagBits samples, AttachmentInput input, AttachmentConsumer consumer, VkImageLayout layout);
+
+	std::vector<VkAttachmentDescription> attachments;
+	std::vector<VkAttachmentReference> colorReferences;
+	std::vector<VkAttachmentReference> resolveReferences;
+	VkAttachmentReference depthReference = { VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED };
+	bool hasDepth = false;
+};
\ No newline at end of file
@@ -0,0 +1,38 @@
+#include "VKResolutionController.h"
+
+#include <algorithm>
+#include <cmath>
+
+void VKResolutionController::update(float gpuTimeMs) {
+	smoothedGpuTimeMs = smoothedGpuTimeMs == 0.f ? gpuTimeMs : smoothedGpuTimeMs * .9f + gpuTimeMs * .1f;
+	if (!enabled || smoothedGpuTimeMs <= 0.f) {
+		return;
+	}
+
+	// drop quickly when over budget, grow back only with clear headroom
+	float ratio = targetFrameTimeMs / smoothedGpuTimeMs;
+	if (ratio < 1.f || ratio > 1.15f) {
+		float desired = scale * std::sqrt(ratio);
+		float step = ratio < 1.f ? 1.f : .05f;
+		scale += std::max(-step, std::min(step, desired - scale));
+		scale = std::max(minScale, std::min(maxScale, scale));
+	}
+}
+
+void VKResolutionController::reset() {
+	scale = 1.f;
+	smoothedGpuTimeMs = 0.f;
+}
+
+VkExtent2D VKResolutionController::getRenderExtent(VkExtent2D fullExtent) const {
+	// snap to multiples of 8 pixels so small scale changes don't touch the resolution every frame
+	auto scaleDimension = [this](uint32_t size) {
+		if (getScale() >= 1.f) {
+			return size;
+		}
+		uint32_t scaled = static_cast<uint32_t>(size * getScale()) & ~7u;
+		return std::max(8u, std::min(size, scaled));
+	};
+
+	return { scaleDimension(fullExtent.width), scaleDimension(fullExtent.height) };
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "VulkanContext.h"
+
+// Picks the internal render resolution from measured GPU frame time. Pixel cost scales with the
+// square of the render scale, so the scale moves by the square root of the budget ratio, smoothed
+// and with a dead zone so it doesn't oscillate around the target.
+class VKResolutionController
+{
+public:
+	void update(float gpuTimeMs);
+	void reset();
+
+	// extent to render at inside a target of fullExtent, never larger than it
+	VkExtent2D getRenderExtent(VkExtent2D fullExtent) const;
+
+	float getScale() const { return enabled ? scale : 1.f; }
+	float getGpuTimeMs() const { return smoothedGpuTimeMs; }
+
+	bool enabled = true;
+	float targetFrameTimeMs = 1000.f / 60.f;
+	float minScale = .5f;
+	float maxScale = 1.f;
+
+private:
+	float scale = 1.f;
+	float smoothedGpuTimeMs = 0.f;
+};
\ No newline at end of file
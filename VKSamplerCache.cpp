@@ -0,0 +1,86 @@
+#include "VKSamplerCache.h"
+
+#include <functional>
+
+VkDevice VKSamplerCache::device = nullptr;
+std::unordered_map<VkSamplerCreateInfo, VkSampler, VKSamplerCache::InfoHash, VKSamplerCache::InfoEqual> VKSamplerCache::samplers;
+
+size_t VKSamplerCache::InfoHash::operator()(const VkSamplerCreateInfo& info) const {
+	size_t hash = 0;
+	auto combine = [&hash](size_t value) {
+		hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	};
+
+	combine(info.flags);
+	combine(info.magFilter);
+	combine(info.minFilter);
+	combine(info.mipmapMode);
+	combine(info.addressModeU);
+	combine(info.addressModeV);
+	combine(info.addressModeW);
+	combine(std::hash<float>()(info.mipLodBias));
+	combine(info.anisotropyEnable);
+	combine(std::hash<float>()(info.maxAnisotropy));
+	combine(info.compareEnable);
+	combine(info.compareOp);
+	combine(std::hash<float>()(info.minLod));
+	combine(std::hash<float>()(info.maxLod));
+	combine(info.borderColor);
+	combine(info.unnormalizedCoordinates);
+	return hash;
+}
+
+bool VKSamplerCache::InfoEqual::operator()(const VkSamplerCreateInfo& a, const VkSamplerCreateInfo& b) const {
+	return a.flags == b.flags && a.magFilter == b.magFilter && a.minFilter == b.minFilter && a.mipmapMode == b.mipmapMode
+		&& a.addressModeU == b.addressModeU && a.addressModeV == b.addressModeV && a.addressModeW == b.addressModeW
+		&& a.mipLodBias == b.mipLodBias && a.anisotropyEnable == b.anisotropyEnable && a.maxAnisotropy == b.maxAnisotropy
+		&& a.compareEnable == b.compareEnable && a.compareOp == b.compareOp && a.minLod == b.minLod && a.maxLod == b.maxLod
+		&& a.borderColor == b.borderColor && a.unnormalizedCoordinates == b.unnormalizedCoordinates;
+}
+
+void VKSamplerCache::initDevices(VkDevice deviceIn) {
+	device = deviceIn;
+}
+
+void VKSamplerCache::destroy() {
+	for (auto& entry : samplers) {
+		vkDestroySampler(device, entry.second, nullptr);
+	}
+	samplers.clear();
+}
+
+VkSampler VKSamplerCache::getSampler(const VkSamplerCreateInfo& info) {
+	CHECK_RESULT((info.pNext == nullptr), "Sampler create info with pNext can't be cached!");
+
+	auto found = samplers.find(info);
+	if (found != samplers.end()) {
+		return found->second;
+	}
+
+	VkSampler sampler;
+	VULKAN_CHECK_RESULT(vkCreateSampler(device, &info, nullptr, &sampler), "Failed to create texture sampler!");
+	samplers.emplace(info, sampler);
+	return sampler;
+}
+
+VkSamplerCreateInfo VKSamplerCache::getTextureSamplerInfo() {
+	VkSamplerCreateInfo samplerInfo = {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.anisotropyEnable = VK_TRUE;
+	samplerInfo.maxAnisotropy = 16;
+	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+	samplerInfo.unnormalizedCoordinates = VK_FALSE;
+	samplerInfo.compareEnable = VK_FALSE;
+	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.mipLodBias = 0.0f;
+	samplerInfo.minLod = 0;
+	// the image view limits the mip chain, so textures with any number of levels share this sampler
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	return samplerInfo;
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "VulkanContext.h"
+
+#include <unordered_map>
+
+// Samplers shared by create info. Textures differ in images, not in how they are sampled, so a
+// handful of samplers serves every texture and stays far below maxSamplerAllocationCount.
+// The cache owns the samplers; users never destroy what getSampler returns.
+class VKSamplerCache
+{
+public:
+	static void initDevices(VkDevice device);
+	static void destroy();
+
+	// info must not have a pNext chain
+	static VkSampler getSampler(const VkSamplerCreateInfo& info);
+	// trilinear, repeating, 16x anisotropic, every mip level
+	static VkSamplerCreateInfo getTextureSamplerInfo();
+
+	static size_t getSamplerCount() { return samplers.size(); }
+
+private:
+	struct InfoHash {
+		size_t operator()(const VkSamplerCreateInfo& info) const;
+	};
+
+	struct InfoEqual {
+		bool operator()(const VkSamplerCreateInfo& a, const VkSamplerCreateInfo& b) const;
+	};
+
+	static VkDevice device;
+	static std::unordered_map<VkSamplerCreateInfo, VkSampler, InfoHash, InfoEqual> samplers;
+};
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "VKScene.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <sstream>
+#include <map>
+#include <algorithm>
+#include <stdexcept>
+
+VKScene VKScene::parse(const char* data, size_t size, const std::string& fileName) {
+	VKScene scene;
+	std::map<std::string, uint32_t> textures;
+	std::map<std::string, uint32_t> meshes;
+	std::map<std::string, uint32_t> materials;
+
+	std::istringstream input(std::string(data, size));
+	std::string line;
+	uint32_t lineNumber = 0;
+
+	auto fail = [&](const std::string& message) {
+		return std::runtime_error(fileName + ":" + std::to_string(lineNumber) + ": " + message);
+	};
+	auto lookup = [&](const std::map<std::string, uint32_t>& names, const std::string& name, const char* kind) {
+		auto found = names.find(name);
+		if (found == names.end()) {
+			throw fail(std::string("unknown ") + kind + " '" + name + "'");
+		}
+		return found->second;
+	};
+
+	while (std::getline(input, line)) {
+		lineNumber++;
+		line = line.substr(0, line.find('#'));
+
+		std::istringstream words(line);
+		std::string statement, name;
+		if (!(words >> statement)) {
+			continue;
+		}
+
+		if (statement == "texture" || statement == "mesh") {
+			std::string path;
+			if (!(words >> name >> path)) {
+				throw fail(statement + " needs a name and a path");
+			}
+			if (statement == "texture") {
+				textures[name] = scene.addTexture(path);
+			}
+			else {
+				meshes[name] = scene.addMesh(path);
+			}
+		}
+		else if (statement == "material") {
+			std::string diffuse;
+			if (!(words >> name >> diffuse)) {
+				throw fail("material needs a name and a diffuse texture");
+			}
+			VKSceneMaterial material;
+			material.diffuseTexture = lookup(textures, diffuse, "texture");
+
+			std::string slot, texture;
+			while (words >> slot) {
+				if (!(words >> texture)) {
+					throw fail(slot + " needs a texture");
+				}
+				if (slot == "normal") {
+					material.normalTexture = static_cast<int32_t>(lookup(textures, texture, "texture"));
+				}
+				else if (slot == "specular") {
+					material.specularTexture = static_cast<int32_t>(lookup(textures, texture, "texture"));
+				}
+				else {
+					throw fail("unknown material slot '" + slot + "'");
+				}
+			}
+			materials[name] = scene.addMaterial(material);
+		}
+		else if (statement == "instance") {
+			std::string mesh, material;
+			if (!(words >> mesh >> material)) {
+				throw fail("instance needs a mesh and a material");
+			}
+
+			glm::vec3 position(0.0f);
+			float angle = 0.0f;
+			glm::vec3 axis(0.0f, 0.0f, 1.0f);
+			float scale = 1.0f;
+
+			std::string property;
+			while (words >> property) {
+				bool valid;
+				if (property == "position") {
+					valid = static_cast<bool>(words >> position.x >> position.y >> position.z);
+				}
+				else if (property == "rotation") {
+					valid = static_cast<bool>(words >> angle >> axis.x >> axis.y >> axis.z) && glm::length(axis) > 0.0f;
+				}
+				else if (property == "scale") {
+					valid = static_cast<bool>(words >> scale);
+				}
+				else {
+					throw fail("unknown instance property '" + property + "'");
+				}
+				if (!valid) {
+					throw fail("bad " + property);
+				}
+			}
+
+			glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+			transform = glm::rotate(transform, glm::radians(angle), glm::normalize(axis));
+			transform = glm::scale(transform, glm::vec3(scale));
+			scene.addInstance(lookup(meshes, mesh, "mesh"), lookup(materials, material, "material"), transform);
+		}
+		else {
+			throw fail("unknown statement '" + statement + "'");
+		}
+	}
+
+	if (scene.instances.empty()) {
+		throw std::runtime_error(fileName + " has no instances!");
+	}
+	return scene;
+}
+
+uint32_t VKScene::addTexture(const std::string& path) {
+	auto found = std::find(texturePaths.begin(), texturePaths.end(), path);
+	if (found != texturePaths.end()) {
+		return static_cast<uint32_t>(found - texturePaths.begin());
+	}
+	texturePaths.push_back(path);
+	return static_cast<uint32_t>(texturePaths.size() - 1);
+}
+
+uint32_t VKScene::addMesh(const std::string& path) {
+	auto found = std::find(meshPaths.begin(), meshPaths.end(), path);
+	if (found != meshPaths.end()) {
+		return static_cast<uint32_t>(found - meshPaths.begin());
+	}
+	meshPaths.push_back(path);
+	return static_cast<uint32_t>(meshPaths.size() - 1);
+}
+
+uint32_t VKScene::addMaterial(const VKSceneMaterial& material) {
+	materials.push_back(material);
+	return static_cast<uint32_t>(materials.size() - 1);
+}
+
+void VKScene::addInstance(uint32_t mesh, uint32_t material, const glm::mat4& transform) {
+	instances.push_back({ mesh, material, transform });
+}
\ No newline at end of file
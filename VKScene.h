@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// indices into the scene's textures
+struct VKSceneMaterial {
+	uint32_t diffuseTexture = 0;
+	// -1 when the material has no such map
+	int32_t normalTexture = -1;
+	int32_t specularTexture = -1;
+};
+
+struct VKSceneInstance {
+	uint32_t mesh;
+	uint32_t material;
+	glm::mat4 transform;
+};
+
+// What a scene loads and where it draws it. Scene files are text, one statement per line:
+//   texture <name> <path>
+//   mesh <name> <path>
+//   material <name> <diffuse texture> [normal <texture>] [specular <texture>]
+//   instance <mesh> <material> [position <x> <y> <z>] [rotation <degrees> <x> <y> <z>] [scale <s>]
+// Names have to be declared before they are used, # starts a comment. Textures and meshes are
+// kept once per path, however many names or materials refer to them.
+class VKScene
+{
+public:
+	// throws with the file and line of the first error
+	static VKScene parse(const char* data, size_t size, const std::string& fileName);
+
+	// index of the entry for path, added if it isn't there yet
+	uint32_t addTexture(const std::string& path);
+	uint32_t addMesh(const std::string& path);
+	uint32_t addMaterial(const VKSceneMaterial& material);
+	void addInstance(uint32_t mesh, uint32_t material, const glm::mat4& transform);
+
+	std::vector<std::string> texturePaths;
+	std::vector<std::string> meshPaths;
+	std::vector<VKSceneMaterial> materials;
+	std::vector<VKSceneInstance> instances;
+};
\ No newline at end of file
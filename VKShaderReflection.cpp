@@ -0,0 +1,746 @@
+#include "VKShaderReflection.h"
+#include "VKAssetCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+
+VkDevice VKShaderReflection::device = nullptr;
+const VKAssetCache* VKShaderReflection::assetCache = nullptr;
+std::unordered_map<VKShaderReflection::ShaderKey, VKShaderLayout, VKShaderReflection::ShaderKeyHash> VKShaderReflection::shaders;
+std::unordered_map<std::vector<VKReflectedBinding>, VkDescriptorSetLayout, VKShaderReflection::BindingsHash> VKShaderReflection::setLayouts;
+std::unordered_map<VKShaderReflection::PipelineLayoutKey, VKReflectedPipelineLayout, VKShaderReflection::PipelineLayoutKeyHash> VKShaderReflection::pipelineLayouts;
+
+namespace {
+	const uint32_t SpirvMagic = 0x07230203;
+	// bump when the parsers change, reflections cached by the old code then miss
+	const uint32_t ReflectionCacheVersion = 1;
+
+	// opcodes, decorations and storage classes the reflection reads
+	enum SpirvOp {
+		OpDecorate = 71,
+		OpMemberDecorate = 72,
+		OpTypeBool = 20,
+		OpTypeInt = 21,
+		OpTypeFloat = 22,
+		OpTypeVector = 23,
+		OpTypeMatrix = 24,
+		OpTypeImage = 25,
+		OpTypeSampler = 26,
+		OpTypeSampledImage = 27,
+		OpTypeArray = 28,
+		OpTypeRuntimeArray = 29,
+		OpTypeStruct = 30,
+		OpTypePointer = 32,
+		OpConstant = 43,
+		OpVariable = 59
+	};
+
+	enum SpirvDecoration {
+		DecorationBlock = 2,
+		DecorationBufferBlock = 3,
+		DecorationArrayStride = 6,
+		DecorationMatrixStride = 7,
+		DecorationBuiltIn = 11,
+		DecorationLocation = 30,
+		DecorationBinding = 33,
+		DecorationDescriptorSet = 34,
+		DecorationOffset = 35
+	};
+
+	enum SpirvStorageClass {
+		StorageUniformConstant = 0,
+		StorageInput = 1,
+		StorageUniform = 2,
+		StoragePushConstant = 9,
+		StorageBuffer = 12
+	};
+
+	enum SpirvDim {
+		DimBuffer = 5,
+		DimSubpassData = 6
+	};
+
+	// 32 bit scalars and vectors only, which covers every vertex format the renderer uses
+	VkFormat getVertexFormat(bool isFloat, bool isSigned, uint32_t components) {
+		static const VkFormat floatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+		static const VkFormat sintFormats[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+		static const VkFormat uintFormats[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+		CHECK_RESULT((components >= 1 && components <= 4), "Unsupported vertex input type!");
+		return isFloat ? floatFormats[components - 1] : isSigned ? sintFormats[components - 1] : uintFormats[components - 1];
+	}
+
+	void addInput(std::vector<VKReflectedInput>* inputs, uint32_t location, uint32_t columns, VkFormat format, uint32_t size) {
+		// matrices take one location per column
+		for (uint32_t i = 0; i < columns; i++) {
+			inputs->push_back({ location + i, format, size });
+		}
+	}
+
+	struct SpirvModule {
+		std::unordered_map<uint32_t, std::vector<uint32_t>> types;
+		std::unordered_map<uint32_t, uint32_t> constants;
+		std::unordered_map<uint32_t, std::map<uint32_t, uint32_t>> decorations;
+		std::unordered_map<uint32_t, std::map<uint32_t, std::map<uint32_t, uint32_t>>> memberDecorations;
+
+		bool hasDecoration(uint32_t id, uint32_t decoration) const {
+			auto found = decorations.find(id);
+			return found != decorations.end() && found->second.count(decoration) != 0;
+		}
+
+		uint32_t getDecoration(uint32_t id, uint32_t decoration) const {
+			auto found = decorations.find(id);
+			if (found == decorations.end() || found->second.count(decoration) == 0) {
+				return 0;
+			}
+			return found->second.at(decoration);
+		}
+
+		uint32_t getMemberDecoration(uint32_t id, uint32_t member, uint32_t decoration) const {
+			auto found = memberDecorations.find(id);
+			if (found == memberDecorations.end() || found->second.count(member) == 0 || found->second.at(member).count(decoration) == 0) {
+				return 0;
+			}
+			return found->second.at(member).at(decoration);
+		}
+
+		// words after the opcode: result id first, then the operands
+		const std::vector<uint32_t>& getType(uint32_t id) const {
+			auto found = types.find(id);
+			CHECK_RESULT((found != types.end()), "Invalid SPIR-V type!");
+			return found->second;
+		}
+
+		uint32_t getSize(uint32_t id, uint32_t matrixStride) const {
+			const std::vector<uint32_t>& type = getType(id);
+			switch (type[0]) {
+			case OpTypeBool:
+				return 4;
+			case OpTypeInt:
+			case OpTypeFloat:
+				return type[2] / 8;
+			case OpTypeVector:
+				return type[3] * getSize(type[2], 0);
+			case OpTypeMatrix:
+				return type[3] * (matrixStride != 0 ? matrixStride : getSize(type[2], 0));
+			case OpTypeArray: {
+				uint32_t stride = getDecoration(type[1], DecorationArrayStride);
+				return constants.at(type[3]) * (stride != 0 ? stride : getSize(type[2], matrixStride));
+			}
+			case OpTypeStruct: {
+				uint32_t size = 0;
+				for (uint32_t member = 0; member + 2 < type.size(); member++) {
+					uint32_t offset = getMemberDecoration(type[1], member, DecorationOffset);
+					uint32_t memberStride = getMemberDecoration(type[1], member, DecorationMatrixStride);
+					size = std::max(size, offset + getSize(type[member + 2], memberStride));
+				}
+				return size;
+			}
+			default:
+				return 0;
+			}
+		}
+	};
+
+	struct GlslType {
+		const char* name;
+		uint32_t size;
+		uint32_t alignment;
+	};
+
+	// std430, which push constant blocks use
+	const GlslType glslTypes[] = {
+		{ "float", 4, 4 }, { "int", 4, 4 }, { "uint", 4, 4 }, { "bool", 4, 4 },
+		{ "vec2", 8, 8 }, { "ivec2", 8, 8 }, { "uvec2", 8, 8 },
+		{ "vec3", 12, 16 }, { "ivec3", 12, 16 }, { "uvec3", 12, 16 },
+		{ "vec4", 16, 16 }, { "ivec4", 16, 16 }, { "uvec4", 16, 16 },
+		{ "mat2", 16, 8 }, { "mat3", 48, 16 }, { "mat4", 64, 16 }
+	};
+
+	const GlslType& getGlslType(const std::string& name) {
+		for (const GlslType& type : glslTypes) {
+			if (name == type.name) {
+				return type;
+			}
+		}
+		throw std::runtime_error("Unsupported push constant member type " + name + "!");
+	}
+
+	std::vector<std::string> tokenizeGlsl(const std::string& source) {
+		std::vector<std::string> tokens;
+		size_t i = 0;
+		while (i < source.size()) {
+			char c = source[i];
+			if (isspace((unsigned char)c)) {
+				i++;
+			}
+			else if (source.compare(i, 2, "//") == 0 || c == '#') {
+				// comments and preprocessor lines
+				i = source.find('\n', i);
+			}
+			else if (source.compare(i, 2, "/*") == 0) {
+				i = source.find("*/", i);
+				i = i == std::string::npos ? i : i + 2;
+			}
+			else if (isalnum((unsigned char)c) || c == '_') {
+				size_t start = i;
+				while (i < source.size() && (isalnum((unsigned char)source[i]) || source[i] == '_')) {
+					i++;
+				}
+				tokens.push_back(source.substr(start, i - start));
+			}
+			else {
+				tokens.push_back(std::string(1, c));
+				i++;
+			}
+		}
+		return tokens;
+	}
+
+	bool isGlslQualifier(const std::string& token) {
+		static const std::set<std::string> qualifiers = { "readonly", "writeonly", "restrict", "coherent", "volatile",
+			"flat", "smooth", "noperspective", "centroid", "invariant", "highp", "mediump", "lowp" };
+		return qualifiers.count(token) != 0;
+	}
+
+	VkDescriptorType getGlslDescriptorType(const std::string& type) {
+		if (type == "sampler" || type == "samplerShadow") {
+			return VK_DESCRIPTOR_TYPE_SAMPLER;
+		}
+		if (type.find("subpassInput") != std::string::npos) {
+			return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+		}
+		if (type.find("sampler") != std::string::npos) {
+			return type.find("Buffer") != std::string::npos ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		}
+		if (type.find("texture") != std::string::npos) {
+			return type.find("Buffer") != std::string::npos ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		}
+		if (type.find("image") != std::string::npos) {
+			return type.find("Buffer") != std::string::npos ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		}
+		throw std::runtime_error("Unsupported uniform type " + type + "!");
+	}
+}
+
+bool VKReflectedBinding::operator==(const VKReflectedBinding& other) const {
+	return set == other.set && binding == other.binding && type == other.type && count == other.count && stages == other.stages;
+}
+
+bool VKShaderReflection::ShaderKey::operator==(const ShaderKey& other) const {
+	return stage == other.stage && code == other.code;
+}
+
+size_t VKShaderReflection::ShaderKeyHash::operator()(const ShaderKey& key) const {
+	uint64_t hash = hashBytes(key.code.data(), key.code.size());
+	return static_cast<size_t>(hashBytes(&key.stage, sizeof(key.stage), hash));
+}
+
+size_t VKShaderReflection::BindingsHash::operator()(const std::vector<VKReflectedBinding>& bindings) const {
+	return static_cast<size_t>(hashBytes(bindings.data(), bindings.size() * sizeof(VKReflectedBinding)));
+}
+
+bool VKShaderReflection::PipelineLayoutKey::operator==(const PipelineLayoutKey& other) const {
+	return pushConstants.stageFlags == other.pushConstants.stageFlags && pushConstants.offset == other.pushConstants.offset
+		&& pushConstants.size == other.pushConstants.size && bindings == other.bindings && externalSets == other.externalSets;
+}
+
+size_t VKShaderReflection::PipelineLayoutKeyHash::operator()(const PipelineLayoutKey& key) const {
+	uint64_t hash = hashBytes(&key.pushConstants, sizeof(key.pushConstants));
+	hash = hashBytes(key.bindings.data(), key.bindings.size() * sizeof(VKReflectedBinding), hash);
+	for (const auto& entry : key.externalSets) {
+		hash = hashBytes(&entry.first, sizeof(entry.first), hash);
+		hash = hashBytes(&entry.second, sizeof(entry.second), hash);
+	}
+	return static_cast<size_t>(hash);
+}
+
+void VKShaderLayout::getVertexInput(uint32_t binding, std::vector<VkVertexInputBindingDescription>* bindings,
+	std::vector<VkVertexInputAttributeDescription>* attributes) const {
+	uint32_t offset = 0;
+	attributes->clear();
+	for (const VKReflectedInput& input : inputs) {
+		VkVertexInputAttributeDescription attribute = {};
+		attribute.binding = binding;
+		attribute.location = input.location;
+		attribute.format = input.format;
+		attribute.offset = offset;
+		attributes->push_back(attribute);
+		offset += input.size;
+	}
+
+	VkVertexInputBindingDescription bindingDescription = {};
+	bindingDescription.binding = binding;
+	bindingDescription.stride = offset;
+	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	*bindings = { bindingDescription };
+}
+
+void VKShaderReflection::initDevices(VkDevice deviceIn) {
+	device = deviceIn;
+}
+
+void VKShaderReflection::setAssetCache(const VKAssetCache* cache) {
+	assetCache = cache;
+}
+
+void VKShaderReflection::destroy() {
+	for (auto& entry : pipelineLayouts) {
+		vkDestroyPipelineLayout(device, entry.second.layout, nullptr);
+	}
+	for (auto& entry : setLayouts) {
+		vkDestroyDescriptorSetLayout(device, entry.second, nullptr);
+	}
+	pipelineLayouts.clear();
+	setLayouts.clear();
+	shaders.clear();
+	assetCache = nullptr;
+}
+
+const VKShaderLayout& VKShaderReflection::reflect(const void* code, size_t size, VkShaderStageFlagBits stage) {
+	const char* text = static_cast<const char*>(code);
+	ShaderKey key = { stage, std::string(text, text + size) };
+
+	auto found = shaders.find(key);
+	if (found != shaders.end()) {
+		return found->second;
+	}
+
+	uint64_t cacheKey = hashBytes(&stage, sizeof(stage), hashBytes(code, size));
+	cacheKey = hashBytes(&ReflectionCacheVersion, sizeof(ReflectionCacheVersion), cacheKey);
+	std::vector<char> cached;
+	if (assetCache != nullptr && assetCache->load("reflection", cacheKey, cached)) {
+		VKAssetCache::Reader reader(cached.data(), cached.size());
+		VKShaderLayout layout;
+		layout.stage = stage;
+		layout.bindings = reader.readArray<VKReflectedBinding>();
+		layout.pushConstantSize = reader.read<uint32_t>();
+		layout.inputs = reader.readArray<VKReflectedInput>();
+		return shaders.emplace(std::move(key), std::move(layout)).first->second;
+	}
+
+	uint32_t magic = 0;
+	if (size >= 20 && size % 4 == 0) {
+		memcpy(&magic, code, sizeof(magic));
+	}
+
+	VKShaderLayout layout;
+	if (magic == SpirvMagic && reinterpret_cast<uintptr_t>(code) % alignof(uint32_t) == 0) {
+		layout = reflectSpirv(static_cast<const uint32_t*>(code), size / 4, stage);
+	}
+	else if (magic == SpirvMagic) {
+		std::vector<uint32_t> words(size / 4);
+		memcpy(words.data(), code, size);
+		layout = reflectSpirv(words.data(), words.size(), stage);
+	}
+	else {
+		layout = reflectGlsl(key.code, stage);
+	}
+
+	std::sort(layout.bindings.begin(), layout.bindings.end(), [](const VKReflectedBinding& a, const VKReflectedBinding& b) {
+		return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+	});
+	std::sort(layout.inputs.begin(), layout.inputs.end(), [](const VKReflectedInput& a, const VKReflectedInput& b) {
+		return a.location < b.location;
+	});
+
+	if (assetCache != nullptr) {
+		VKAssetCache::Writer writer;
+		writer.writeArray(layout.bindings);
+		writer.write(layout.pushConstantSize);
+		writer.writeArray(layout.inputs);
+		assetCache->store("reflection", cacheKey, writer.data);
+	}
+
+	return shaders.emplace(std::move(key), std::move(layout)).first->second;
+}
+
+VKShaderLayout VKShaderReflection::reflectSpirv(const uint32_t* code, size_t wordCount, VkShaderStageFlagBits stage) {
+	SpirvModule module;
+	std::vector<std::vector<uint32_t>> variables;
+
+	// the header is 5 words, then every instruction starts with its word count and opcode
+	for (size_t i = 5; i < wordCount;) {
+		uint32_t opcode = code[i] & 0xffff;
+		uint32_t length = code[i] >> 16;
+		CHECK_RESULT((length != 0 && i + length <= wordCount), "Invalid SPIR-V!");
+		std::vector<uint32_t> operands(code + i + 1, code + i + length);
+
+		switch (opcode) {
+		case OpDecorate:
+			if (operands.size() >= 2) {
+				module.decorations[operands[0]][operands[1]] = operands.size() >= 3 ? operands[2] : 1;
+			}
+			break;
+		case OpMemberDecorate:
+			if (operands.size() >= 3) {
+				module.memberDecorations[operands[0]][operands[1]][operands[2]] = operands.size() >= 4 ? operands[3] : 1;
+			}
+			break;
+		case OpConstant:
+			if (operands.size() >= 3) {
+				module.constants[operands[1]] = operands[2];
+			}
+			break;
+		case OpVariable:
+			variables.push_back(operands);
+			break;
+		default:
+			if (opcode >= OpTypeBool && opcode <= OpTypePointer && !operands.empty()) {
+				std::vector<uint32_t> type = { opcode };
+				type.insert(type.end(), operands.begin(), operands.end());
+				module.types[operands[0]] = type;
+			}
+			break;
+		}
+		i += length;
+	}
+
+	VKShaderLayout layout;
+	layout.stage = stage;
+
+	for (const std::vector<uint32_t>& variable : variables) {
+		// result type, result id, storage class
+		uint32_t id = variable[1];
+		uint32_t storageClass = variable[2];
+		const std::vector<uint32_t>& pointer = module.getType(variable[0]);
+		uint32_t typeId = pointer[3];
+
+		if (storageClass == StorageInput) {
+			if (stage != VK_SHADER_STAGE_VERTEX_BIT || !module.hasDecoration(id, DecorationLocation)) {
+				continue;
+			}
+			const std::vector<uint32_t>* type = &module.getType(typeId);
+			uint32_t columns = 1;
+			if ((*type)[0] == OpTypeMatrix) {
+				columns = (*type)[3];
+				type = &module.getType((*type)[2]);
+			}
+			uint32_t components = 1;
+			if ((*type)[0] == OpTypeVector) {
+				components = (*type)[3];
+				type = &module.getType((*type)[2]);
+			}
+			CHECK_RESULT(((*type)[0] != OpTypeFloat || (*type)[2] == 32), "Unsupported vertex input type!");
+			bool isFloat = (*type)[0] == OpTypeFloat;
+			bool isSigned = (*type)[0] == OpTypeInt && (*type)[3] != 0;
+			addInput(&layout.inputs, module.getDecoration(id, DecorationLocation), columns,
+				getVertexFormat(isFloat, isSigned, components), components * 4);
+			continue;
+		}
+
+		if (storageClass == StoragePushConstant) {
+			layout.pushConstantSize = std::max(layout.pushConstantSize, module.getSize(typeId, 0));
+			continue;
+		}
+
+		if (storageClass != StorageUniformConstant && storageClass != StorageUniform && storageClass != StorageBuffer) {
+			continue;
+		}
+
+		VKReflectedBinding binding = {};
+		binding.set = module.getDecoration(id, DecorationDescriptorSet);
+		binding.binding = module.getDecoration(id, DecorationBinding);
+		binding.count = 1;
+		binding.stages = stage;
+
+		const std::vector<uint32_t>* type = &module.getType(typeId);
+		if ((*type)[0] == OpTypeArray) {
+			binding.count = module.constants.at((*type)[3]);
+			type = &module.getType((*type)[2]);
+		}
+		else if ((*type)[0] == OpTypeRuntimeArray) {
+			binding.count = 0;
+			type = &module.getType((*type)[2]);
+		}
+
+		switch ((*type)[0]) {
+		case OpTypeSampler:
+			binding.type = VK_DESCRIPTOR_TYPE_SAMPLER;
+			break;
+		case OpTypeSampledImage:
+			binding.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			break;
+		case OpTypeImage: {
+			// result id, sampled type, dim, depth, arrayed, multisampled, sampled
+			uint32_t dim = (*type)[3];
+			bool storage = (*type)[7] == 2;
+			if (dim == DimSubpassData) {
+				binding.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+			}
+			else if (dim == DimBuffer) {
+				binding.type = storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+			}
+			else {
+				binding.type = storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			}
+			break;
+		}
+		case OpTypeStruct:
+			// before SPIR-V 1.3 storage buffers are uniform blocks decorated BufferBlock
+			binding.type = storageClass == StorageBuffer || module.hasDecoration((*type)[1], DecorationBufferBlock)
+				? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			break;
+		default:
+			continue;
+		}
+		layout.bindings.push_back(binding);
+	}
+
+	return layout;
+}
+
+VKShaderLayout VKShaderReflection::reflectGlsl(const std::string& source, VkShaderStageFlagBits stage) {
+	std::vector<std::string> tokens = tokenizeGlsl(source);
+
+	VKShaderLayout layout;
+	layout.stage = stage;
+
+	auto isNumber = [](const std::string& token) {
+		return !token.empty() && isdigit((unsigned char)token[0]);
+	};
+
+	for (size_t i = 0; i + 1 < tokens.size(); i++) {
+		if (tokens[i] != "layout" || tokens[i + 1] != "(") {
+			continue;
+		}
+
+		// layout qualifiers, e.g. (std430, set = 1, binding = 2)
+		std::map<std::string, uint32_t> qualifiers;
+		for (i += 2; i < tokens.size() && tokens[i] != ")"; i++) {
+			if (tokens[i] == ",") {
+				continue;
+			}
+			if (i + 2 < tokens.size() && tokens[i + 1] == "=" && isNumber(tokens[i + 2])) {
+				qualifiers[tokens[i]] = (uint32_t)std::stoul(tokens[i + 2]);
+				i += 2;
+			}
+			else {
+				qualifiers[tokens[i]] = 1;
+			}
+		}
+
+		// the declaration up to its semicolon, including a block's members
+		std::vector<std::string> declaration;
+		int depth = 0;
+		for (i++; i < tokens.size(); i++) {
+			if (tokens[i] == "{") {
+				depth++;
+			}
+			else if (tokens[i] == "}") {
+				depth--;
+			}
+			else if (tokens[i] == ";" && depth == 0) {
+				break;
+			}
+			declaration.push_back(tokens[i]);
+		}
+
+		size_t d = 0;
+		while (d < declaration.size() && isGlslQualifier(declaration[d])) {
+			d++;
+		}
+		if (d + 1 >= declaration.size()) {
+			// e.g. layout(local_size_x = 64) in;
+			continue;
+		}
+		std::string storage = declaration[d++];
+		while (d < declaration.size() && isGlslQualifier(declaration[d])) {
+			d++;
+		}
+		bool isBlock = d + 1 < declaration.size() && declaration[d + 1] == "{";
+
+		if (storage == "in") {
+			if (stage != VK_SHADER_STAGE_VERTEX_BIT || qualifiers.count("location") == 0) {
+				continue;
+			}
+			std::string type = declaration[d];
+			uint32_t columns = 1;
+			uint32_t components = 1;
+			if (type.compare(0, 3, "mat") == 0) {
+				columns = components = type[3] - '0';
+			}
+			else if (type.find("vec") != std::string::npos) {
+				components = type.back() - '0';
+			}
+			bool isFloat = type[0] == 'f' || type[0] == 'v' || type[0] == 'm';
+			bool isSigned = type[0] == 'i';
+			addInput(&layout.inputs, qualifiers["location"], columns, getVertexFormat(isFloat, isSigned, components), components * 4);
+			continue;
+		}
+
+		if (storage != "uniform" && storage != "buffer") {
+			continue;
+		}
+
+		if (qualifiers.count("push_constant") != 0) {
+			// members are "type name [count] ;" between the braces
+			uint32_t offset = 0;
+			size_t m = d + 2;
+			while (m < declaration.size() && declaration[m] != "}") {
+				std::vector<std::string> member;
+				std::string previous;
+				for (; m < declaration.size() && previous != ";"; m++) {
+					member.push_back(declaration[m]);
+					previous = declaration[m];
+				}
+				if (member.size() >= 6 && member[0] == "layout" && member[2] == "offset") {
+					offset = (uint32_t)std::stoul(member[4]);
+					member.erase(member.begin(), member.begin() + 6);
+				}
+				size_t t = 0;
+				while (t < member.size() && isGlslQualifier(member[t])) {
+					t++;
+				}
+				CHECK_RESULT((t + 2 < member.size()), "Invalid push constant block!");
+				const GlslType& type = getGlslType(member[t]);
+				uint32_t count = 1;
+				if (member[t + 2] == "[") {
+					count = (uint32_t)std::stoul(member[t + 3]);
+				}
+				uint32_t stride = count > 1 ? (type.size + type.alignment - 1) / type.alignment * type.alignment : type.size;
+				offset = (offset + type.alignment - 1) / type.alignment * type.alignment;
+				offset += stride * (count - 1) + type.size;
+			}
+			layout.pushConstantSize = std::max(layout.pushConstantSize, offset);
+			continue;
+		}
+
+		VKReflectedBinding binding = {};
+		binding.set = qualifiers.count("set") != 0 ? qualifiers["set"] : 0;
+		binding.binding = qualifiers.count("binding") != 0 ? qualifiers["binding"] : 0;
+		binding.count = 1;
+		binding.stages = stage;
+
+		size_t name;
+		if (isBlock) {
+			binding.type = storage == "buffer" ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			// the instance name follows the closing brace, if there is one
+			name = std::find(declaration.begin() + d, declaration.end(), "}") - declaration.begin() + 1;
+		}
+		else {
+			binding.type = getGlslDescriptorType(declaration[d]);
+			name = d + 1;
+		}
+
+		if (name + 1 < declaration.size() && declaration[name + 1] == "[") {
+			binding.count = isNumber(declaration[name + 2]) ? (uint32_t)std::stoul(declaration[name + 2]) : 0;
+		}
+		layout.bindings.push_back(binding);
+	}
+
+	return layout;
+}
+
+VKReflectedPipelineLayout VKShaderReflection::getPipelineLayout(const std::vector<const VKShaderLayout*>& shaderLayouts,
+	const std::map<uint32_t, VkDescriptorSetLayout>& externalSets, bool create) {
+	// bindings used by several stages are visible to all of them
+	std::map<std::pair<uint32_t, uint32_t>, VKReflectedBinding> merged;
+	VkPushConstantRange pushConstants = {};
+	uint32_t setCount = externalSets.empty() ? 0 : externalSets.rbegin()->first + 1;
+
+	for (const VKShaderLayout* shader : shaderLayouts) {
+		for (const VKReflectedBinding& binding : shader->bindings) {
+			auto found = merged.find({ binding.set, binding.binding });
+			if (found == merged.end()) {
+				merged[{ binding.set, binding.binding }] = binding;
+			}
+			else {
+				CHECK_RESULT((found->second.type == binding.type), "Shader stages disagree on a descriptor binding!");
+				found->second.count = std::max(found->second.count, binding.count);
+				found->second.stages |= binding.stages;
+			}
+			setCount = std::max(setCount, binding.set + 1);
+		}
+		if (shader->pushConstantSize != 0) {
+			pushConstants.stageFlags |= shader->stage;
+			pushConstants.size = std::max(pushConstants.size, shader->pushConstantSize);
+		}
+	}
+
+	PipelineLayoutKey key = { pushConstants, {}, std::vector<std::pair<uint32_t, VkDescriptorSetLayout>>(externalSets.begin(), externalSets.end()) };
+	for (const auto& entry : merged) {
+		key.bindings.push_back(entry.second);
+	}
+
+	auto found = pipelineLayouts.find(key);
+	if (found != pipelineLayouts.end()) {
+		return found->second;
+	}
+	if (!create) {
+		return {};
+	}
+
+	VKReflectedPipelineLayout result;
+	result.pushConstants = pushConstants;
+	for (uint32_t set = 0; set < setCount; set++) {
+		auto external = externalSets.find(set);
+		if (external != externalSets.end()) {
+			result.setLayouts.push_back(external->second);
+			continue;
+		}
+
+		std::vector<VKReflectedBinding> bindings;
+		for (const VKReflectedBinding& binding : key.bindings) {
+			if (binding.set == set) {
+				bindings.push_back(binding);
+			}
+		}
+		result.setLayouts.push_back(getSetLayout(bindings));
+	}
+
+	VkPipelineLayoutCreateInfo info = {};
+	info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	info.setLayoutCount = static_cast<uint32_t>(result.setLayouts.size());
+	info.pSetLayouts = result.setLayouts.data();
+	info.pushConstantRangeCount = pushConstants.size != 0 ? 1 : 0;
+	info.pPushConstantRanges = &result.pushConstants;
+
+	VULKAN_CHECK_RESULT(vkCreatePipelineLayout(device, &info, nullptr, &result.layout), "Failed to create pipeline layout!");
+
+	pipelineLayouts.emplace(std::move(key), result);
+	return result;
+}
+
+VkDescriptorSetLayout VKShaderReflection::getSetLayout(const std::vector<VKReflectedBinding>& bindings) {
+	auto found = setLayouts.find(bindings);
+	if (found != setLayouts.end()) {
+		return found->second;
+	}
+
+	std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+	for (const VKReflectedBinding& binding : bindings) {
+		// unbounded arrays need binding flags only the owner of the set knows, e.g. the texture table
+		CHECK_RESULT((binding.count != 0), "Runtime sized descriptor arrays need an external set layout!");
+
+		VkDescriptorSetLayoutBinding layoutBinding = {};
+		layoutBinding.binding = binding.binding;
+		layoutBinding.descriptorType = binding.type;
+		layoutBinding.descriptorCount = binding.count;
+		layoutBinding.stageFlags = binding.stages;
+		layoutBinding.pImmutableSamplers = nullptr;
+		layoutBindings.push_back(layoutBinding);
+	}
+
+	VkDescriptorSetLayoutCreateInfo info = {};
+	info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	info.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+	info.pBindings = layoutBindings.data();
+
+	VkDescriptorSetLayout layout;
+	VULKAN_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &info, nullptr, &layout), "Failed to create descriptor set layout!");
+
+	setLayouts.emplace(bindings, layout);
+	return layout;
+}
+
+uint64_t VKShaderReflection::hashBytes(const void* data, size_t size, uint64_t hash) {
+	// FNV-1a
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "VulkanContext.h"
+
+#include <vector>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+class VKAssetCache;
+
+struct VKReflectedBinding {
+	uint32_t set;
+	uint32_t binding;
+	VkDescriptorType type;
+	// 0 for runtime sized arrays
+	uint32_t count;
+	VkShaderStageFlags stages;
+
+	bool operator==(const VKReflectedBinding& other) const;
+};
+
+struct VKReflectedInput {
+	uint32_t location;
+	VkFormat format;
+	uint32_t size;
+};
+
+// what one shader stage needs from its pipeline layout and, for vertex shaders, from the vertex input
+struct VKShaderLayout {
+	VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+	std::vector<VKReflectedBinding> bindings;
+	uint32_t pushConstantSize = 0;
+	// sorted by location
+	std::vector<VKReflectedInput> inputs;
+
+	// every input interleaved in location order in one buffer
+	void getVertexInput(uint32_t binding, std::vector<VkVertexInputBindingDescription>* bindings,
+		std::vector<VkVertexInputAttributeDescription>* attributes) const;
+};
+
+struct VKReflectedPipelineLayout {
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSetLayout> setLayouts;
+	// a single range shared by every stage that declares push constants
+	VkPushConstantRange pushConstants = {};
+};
+
+// Descriptor bindings, push constants and vertex inputs read from shader code, so the layouts
+// never have to be written by hand to match the shaders. Real SPIR-V is parsed from its
+// decorations and types; code that isn't SPIR-V is read as GLSL source from its layout qualifiers.
+// Reflections are cached by shader code, in memory and in the asset cache when one is set, and
+// equal set and pipeline layouts are created once. The cache owns every layout it returns.
+class VKShaderReflection
+{
+public:
+	static void initDevices(VkDevice device);
+	static void setAssetCache(const VKAssetCache* cache);
+	static void destroy();
+
+	static const VKShaderLayout& reflect(const void* code, size_t size, VkShaderStageFlagBits stage);
+
+	// merges the stages' bindings; sets listed in externalSets use the given layout instead of a reflected one.
+	// Without create nothing is made, and a layout that doesn't exist yet comes back as VK_NULL_HANDLE
+	static VKReflectedPipelineLayout getPipelineLayout(const std::vector<const VKShaderLayout*>& shaders,
+		const std::map<uint32_t, VkDescriptorSetLayout>& externalSets = {}, bool create = true);
+
+	static size_t getSetLayoutCount() { return setLayouts.size(); }
+	static size_t getPipelineLayoutCount() { return pipelineLayouts.size(); }
+
+private:
+	static VKShaderLayout reflectSpirv(const uint32_t* code, size_t wordCount, VkShaderStageFlagBits stage);
+	static VKShaderLayout reflectGlsl(const std::string& source, VkShaderStageFlagBits stage);
+
+	// the caches compare the whole key, the hash only picks the bucket
+	struct ShaderKey {
+		VkShaderStageFlagBits stage;
+		std::string code;
+
+		bool operator==(const ShaderKey& other) const;
+	};
+
+	struct ShaderKeyHash {
+		size_t operator()(const ShaderKey& key) const;
+	};
+
+	struct BindingsHash {
+		size_t operator()(const std::vector<VKReflectedBinding>& bindings) const;
+	};
+
+	struct PipelineLayoutKey {
+		VkPushConstantRange pushConstants;
+		std::vector<VKReflectedBinding> bindings;
+		std::vector<std::pair<uint32_t, VkDescriptorSetLayout>> externalSets;
+
+		bool operator==(const PipelineLayoutKey& other) const;
+	};
+
+	struct PipelineLayoutKeyHash {
+		size_t operator()(const PipelineLayoutKey& key) const;
+	};
+
+	static VkDescriptorSetLayout getSetLayout(const std::vector<VKReflectedBinding>& bindings);
+	static uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+	static VkDevice device;
+	static const VKAssetCache* assetCache;
+	static std::unordered_map<ShaderKey, VKShaderLayout, ShaderKeyHash> shaders;
+	static std::unordered_map<std::vector<VKReflectedBinding>, VkDescriptorSetLayout, BindingsHash> setLayouts;
+	static std::unordered_map<PipelineLayoutKey, VKReflectedPipelineLayout, PipelineLayoutKeyHash> pipelineLayouts;
+};
\ No newline at end of file
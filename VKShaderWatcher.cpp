@@ -0,0 +1,104 @@
+#include "VKShaderWatcher.h"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+VKShaderWatcher::~VKShaderWatcher() {
+	stop();
+}
+
+void VKShaderWatcher::watch(const std::string& directoryIn) {
+	stop();
+	directory = directoryIn;
+
+#ifdef __linux__
+	inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	// editors either rewrite the file or rename a temporary over it
+	if (inotifyFd >= 0 && inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		close(inotifyFd);
+		inotifyFd = -1;
+	}
+	if (inotifyFd >= 0) {
+		return;
+	}
+	std::cerr << "inotify unavailable, scanning " << directory << " for changes instead" << std::endl;
+#endif
+
+	// the first scan only records the current write times, every file in it is new
+	pollWriteTimes();
+}
+
+void VKShaderWatcher::stop() {
+#ifdef __linux__
+	if (inotifyFd >= 0) {
+		close(inotifyFd);
+		inotifyFd = -1;
+	}
+#endif
+	writeTimes.clear();
+	directory.clear();
+}
+
+std::vector<std::string> VKShaderWatcher::poll() {
+	if (directory.empty()) {
+		return {};
+	}
+
+#ifdef __linux__
+	if (inotifyFd >= 0) {
+		std::vector<std::string> changed;
+		alignas(inotify_event) char buffer[4096];
+		ssize_t length;
+		while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+			for (char* event = buffer; event < buffer + length;) {
+				const inotify_event* info = reinterpret_cast<const inotify_event*>(event);
+				if (info->len > 0) {
+					std::string path = directory + "/" + info->name;
+					if (std::find(changed.begin(), changed.end(), path) == changed.end()) {
+						changed.push_back(path);
+					}
+				}
+				event += sizeof(inotify_event) + info->len;
+			}
+		}
+		return changed;
+	}
+#endif
+
+	auto now = std::chrono::steady_clock::now();
+	if (now - lastScan < std::chrono::milliseconds(250)) {
+		return {};
+	}
+	return pollWriteTimes();
+}
+
+std::vector<std::string> VKShaderWatcher::pollWriteTimes() {
+	lastScan = std::chrono::steady_clock::now();
+
+	std::vector<std::string> changed;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+		if (!entry.is_regular_file(error)) {
+			continue;
+		}
+
+		std::string path = directory + "/" + entry.path().filename().string();
+		std::filesystem::file_time_type writeTime = entry.last_write_time(error);
+		auto known = writeTimes.find(path);
+		if (known == writeTimes.end()) {
+			writeTimes[path] = writeTime;
+			changed.push_back(path);
+		}
+		else if (known->second != writeTime) {
+			known->second = writeTime;
+			changed.push_back(path);
+		}
+	}
+	return changed;
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <filesystem>
+
+// Reports files that changed in a directory. On Linux the kernel tells us through inotify; elsewhere
+// the directory's write times are compared a few times a second, which is cheap for a shader folder.
+// Nothing blocks, poll is meant to be called once per frame.
+class VKShaderWatcher
+{
+public:
+	VKShaderWatcher(const VKShaderWatcher&) = delete;
+	VKShaderWatcher() = default;
+	~VKShaderWatcher();
+
+	void watch(const std::string& directory);
+	void stop();
+
+	// paths as directory/name of files written since the last call, each reported once
+	std::vector<std::string> poll();
+
+private:
+	std::vector<std::string> pollWriteTimes();
+
+	std::string directory;
+
+#ifdef __linux__
+	int inotifyFd = -1;
+#endif
+
+	std::map<std::string, std::filesystem::file_time_type> writeTimes;
+	std::chrono::steady_clock::time_point lastScan;
+};
\ No newline at end of file
@@ -25,7 +25,7 @@ void VKSwapchain::createSwapChain() {
 	vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &formatCount, availableFormats.data());
 	VkSurfaceFormatKHR surfaceFormat = chooseSurfaceFormat(availableFormats);
 
-	uint32_t imageCount = surfaceCapabilities.minImageCount + 1;
+	uint32_t imageCount = surfaceCapabilities.minImageCount + extraImageCount;
 	if (surfaceCapabilities.maxImageCount > 0 && imageCount > surfaceCapabilities.maxImageCount) {
 		imageCount = surfaceCapabilities.maxImageCount;
 	}
@@ -45,7 +45,9 @@ void VKSwapchain::createSwapChain() {
 
 	info.imageExtent = chooseExtent(surfaceCapabilities);
 	info.imageArrayLayers = 1;
-	info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	// the scene is scaled or copied onto the image, it's never rendered to directly
+	CHECK_RESULT((surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT), "Surface doesn't support transfers to swap chain images!");
+	info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
 	if (queueFamilyIndices.graphicsFamily.value() != queueFamilyIndices.presentationFamily.value()) {
 		uint32_t indices[] = { queueFamilyIndices.graphicsFamily.value(), queueFamilyIndices.presentationFamily.value() };
@@ -61,7 +63,8 @@ void VKSwapchain::createSwapChain() {
 
 	info.preTransform = surfaceCapabilities.currentTransform;
 	info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-	info.presentMode = choosePresentMode(availableModes);
+	presentMode = choosePresentMode(availableModes);
+	info.presentMode = presentMode;
 	info.clipped = VK_TRUE;
 	info.oldSwapchain = 0;
 
@@ -76,10 +79,6 @@ void VKSwapchain::createSwapChain() {
 }
 
 void VKSwapchain::free() {
-	for (size_t i = 0; i < framebuffers.size(); i++) {
-		vkDestroyFramebuffer(device, framebuffers[i], nullptr);
-	}
-
 	for (size_t i = 0; i < imageViews.size(); i++) {
 		vkDestroyImageView(device, imageViews[i], nullptr);
 	}
@@ -97,28 +96,6 @@ void VKSwapchain::createSurface(VkInstance instance, GLFWwindow* windowIn) {
 	VULKAN_CHECK_RESULT(vkCreateWin32SurfaceKHR(instance, &info, nullptr, &surface), "Failed to create window surface!");
 }
 
-void VKSwapchain::createFramebuffers(VkRenderPass renderPass, const VKImage &colorImage, const VKImage &depthImage) {
-	framebuffers.resize(images.size());
-	for (size_t i = 0; i < imageViews.size(); i++) {
-		std::array<VkImageView, 3> attachments = {
-			colorImage.imageView,
-			depthImage.imageView,
-			imageViews[i]
-		};
-
-		VkFramebufferCreateInfo info = {};
-		info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		info.renderPass = renderPass;
-		info.attachmentCount = static_cast<uint32_t>(attachments.size());
-		info.pAttachments = attachments.data();
-		info.height = extent.height;
-		info.width = extent.width;
-		info.layers = 1;
-
-		VULKAN_CHECK_RESULT(vkCreateFramebuffer(device, &info, nullptr, &framebuffers[i]), "Failed to create framebuffer!");
-	}
-}
-
 VkSurfaceFormatKHR VKSwapchain::chooseSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) {
 	if (availableFormats.size() == 1 && availableFormats[0].format == VK_FORMAT_UNDEFINED) {
 		return { VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
@@ -154,18 +131,13 @@ VkExtent2D VKSwapchain::chooseExtent(const VkSurfaceCapabilitiesKHR& capabilitie
 }
 
 VkPresentModeKHR VKSwapchain::choosePresentMode(const std::vector<VkPresentModeKHR> availablePresentModes) {
-	VkPresentModeKHR bestMode = VK_PRESENT_MODE_FIFO_KHR;
-
-	for (const auto& availablePresentMode : availablePresentModes) {
-		if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-			return availablePresentMode;
-		}
-		else if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-			bestMode = availablePresentMode;
+	for (VkPresentModeKHR preferredMode : preferredPresentModes) {
+		if (std::find(availablePresentModes.begin(), availablePresentModes.end(), preferredMode) != availablePresentModes.end()) {
+			return preferredMode;
 		}
 	}
 
-	return bestMode;
+	return VK_PRESENT_MODE_FIFO_KHR;
 }
 
 void VKSwapchain::createImageViews() {
@@ -15,7 +15,6 @@ public:
 	void free();
 
 	void createSurface(VkInstance instance, GLFWwindow* window);
-	void createFramebuffers(VkRenderPass renderPass, const VKImage& colorImage, const VKImage& depthImage);
 
 	VkSurfaceFormatKHR chooseSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
 	VkExtent2D chooseExtent(const VkSurfaceCapabilitiesKHR& capabilities);
@@ -30,12 +29,15 @@ public:
 
 	VkFormat imageFormat = {};
 	VkExtent2D extent = {};
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+
+	// filled from the frame pacer before createSwapChain
+	std::vector<VkPresentModeKHR> preferredPresentModes = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+	uint32_t extraImageCount = 1;
 
 	std::vector<VkImage> images;
 	std::vector<VkImageView> imageViews;
 
-	std::vector<VkFramebuffer> framebuffers;
-
 private:
 	static VkDevice device;
 	static VkPhysicalDevice physicalDevice;
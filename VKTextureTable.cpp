@@ -0,0 +1,116 @@
+#include "VKTextureTable.h"
+
+#include <algorithm>
+
+VkDevice VKTextureTable::device = nullptr;
+VkPhysicalDevice VKTextureTable::physicalDevice = nullptr;
+
+void VKTextureTable::initDevices(VkDevice deviceIn, VkPhysicalDevice physicalDeviceIn) {
+	device = deviceIn;
+	physicalDevice = physicalDeviceIn;
+}
+
+uint32_t VKTextureTable::getMaxTextures() {
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties = {};
+	indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+
+	VkPhysicalDeviceProperties2 properties = {};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &indexingProperties;
+	vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+	// a combined image sampler counts against both the sampler and the sampled image limits
+	return std::min({ indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+		indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages });
+}
+
+VKTextureTable::~VKTextureTable() {
+	clear();
+}
+
+void VKTextureTable::create(uint32_t maxTextures) {
+	capacity = std::min(maxTextures, getMaxTextures());
+	textureCount = 0;
+
+	VkDescriptorSetLayoutBinding binding = {};
+	binding.binding = 0;
+	binding.descriptorCount = capacity;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	binding.pImmutableSamplers = nullptr;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	// slots past the registered textures are never written, and registering doesn't disturb frames in flight
+	VkDescriptorBindingFlagsEXT bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT;
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo = {};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+	bindingFlagsInfo.bindingCount = 1;
+	bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &bindingFlagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+
+	VULKAN_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout), "Failed to create texture table layout!");
+
+	VkDescriptorPoolSize poolSize = {};
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = capacity;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	poolInfo.maxSets = 1;
+
+	VULKAN_CHECK_RESULT(vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool), "Failed to create texture table pool!");
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = pool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	VULKAN_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &set), "Failed to allocate texture table!");
+}
+
+void VKTextureTable::clear() {
+	if (pool) {
+		vkDestroyDescriptorPool(device, pool, nullptr);
+		pool = VK_NULL_HANDLE;
+		set = VK_NULL_HANDLE;
+	}
+	if (layout) {
+		vkDestroyDescriptorSetLayout(device, layout, nullptr);
+		layout = VK_NULL_HANDLE;
+	}
+	capacity = 0;
+	textureCount = 0;
+}
+
+uint32_t VKTextureTable::registerTexture(const VKImage& texture) {
+	CHECK_RESULT((textureCount < capacity), "Texture table is full!");
+
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = texture.imageView;
+	imageInfo.sampler = texture.sampler;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = set;
+	write.dstBinding = 0;
+	write.dstArrayElement = textureCount;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.descriptorCount = 1;
+	write.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+	return textureCount++;
+}
\ No newline at end of file
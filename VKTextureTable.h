@@ -0,0 +1,39 @@
+#pragma once
+
+#include "VulkanContext.h"
+#include "VkImage.h"
+
+// Every texture lives in one partially bound, update-after-bind array of combined image samplers.
+// Textures register once and materials refer to them by index, so draws never rebind texture
+// descriptors and new textures can be added while frames using the table are in flight.
+class VKTextureTable
+{
+public:
+	static void initDevices(VkDevice device, VkPhysicalDevice physicalDevice);
+	// how many textures a single table can hold on this device
+	static uint32_t getMaxTextures();
+
+	VKTextureTable(const VKTextureTable&) = delete;
+	VKTextureTable() = default;
+	~VKTextureTable();
+
+	void create(uint32_t maxTextures);
+	void clear();
+
+	// writes the texture into the next free slot and returns its index
+	uint32_t registerTexture(const VKImage& texture);
+
+	uint32_t getTextureCount() const { return textureCount; }
+	uint32_t getCapacity() const { return capacity; }
+
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	VkDescriptorSet set = VK_NULL_HANDLE;
+
+private:
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	uint32_t capacity = 0;
+	uint32_t textureCount = 0;
+
+	static VkDevice device;
+	static VkPhysicalDevice physicalDevice;
+};
\ No newline at end of file
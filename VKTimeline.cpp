@@ -0,0 +1,101 @@
+#include "VKTimeline.h"
+
+#include <algorithm>
+#include <limits>
+
+VkSemaphore VKTimeline::semaphore = VK_NULL_HANDLE;
+VkDevice VKTimeline::device = nullptr;
+uint64_t VKTimeline::pendingValue = 0;
+uint64_t VKTimeline::completedValue = 0;
+std::deque<VKTimeline::DeferredDestroy> VKTimeline::deferred;
+PFN_vkWaitSemaphoresKHR VKTimeline::waitSemaphores = nullptr;
+PFN_vkGetSemaphoreCounterValueKHR VKTimeline::getSemaphoreCounterValue = nullptr;
+
+void VKTimeline::create(VkDevice deviceIn) {
+	device = deviceIn;
+
+	waitSemaphores = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR");
+	getSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR");
+	CHECK_RESULT((waitSemaphores && getSemaphoreCounterValue), "Failed to load timeline semaphore functions!");
+
+	VkSemaphoreTypeCreateInfoKHR typeInfo = {};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+	typeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo info = {};
+	info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	info.pNext = &typeInfo;
+
+	VULKAN_CHECK_RESULT(vkCreateSemaphore(device, &info, nullptr, &semaphore), "Failed to create timeline semaphore!");
+
+	pendingValue = 0;
+	completedValue = 0;
+}
+
+void VKTimeline::destroy() {
+	wait(pendingValue);
+	collectGarbage();
+
+	vkDestroySemaphore(device, semaphore, nullptr);
+	semaphore = VK_NULL_HANDLE;
+}
+
+uint64_t VKTimeline::nextSignalValue() {
+	return ++pendingValue;
+}
+
+uint64_t VKTimeline::getPendingValue() {
+	return pendingValue;
+}
+
+uint64_t VKTimeline::getCompletedValue() {
+	if (completedValue < pendingValue) {
+		getSemaphoreCounterValue(device, semaphore, &completedValue);
+	}
+	return completedValue;
+}
+
+bool VKTimeline::isComplete(uint64_t value) {
+	return value <= completedValue || value <= getCompletedValue();
+}
+
+void VKTimeline::wait(uint64_t value) {
+	if (isComplete(value))
+		return;
+
+	VkSemaphoreWaitInfoKHR waitInfo = {};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &semaphore;
+	waitInfo.pValues = &value;
+
+	VULKAN_CHECK_RESULT(waitSemaphores(device, &waitInfo, std::numeric_limits<uint64_t>::max()), "Failed to wait for timeline semaphore!");
+	completedValue = std::max(completedValue, value);
+}
+
+void VKTimeline::deferDestroy(std::function<void()> destroyFunc) {
+	deferDestroy(pendingValue, std::move(destroyFunc));
+}
+
+void VKTimeline::deferDestroy(uint64_t value, std::function<void()> destroyFunc) {
+	if (isComplete(value)) {
+		destroyFunc();
+		return;
+	}
+	deferred.push_back({ value, std::move(destroyFunc) });
+}
+
+void VKTimeline::collectGarbage() {
+	uint64_t completed = getCompletedValue();
+
+	for (auto it = deferred.begin(); it != deferred.end();) {
+		if (it->value <= completed) {
+			it->destroyFunc();
+			it = deferred.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "VulkanContext.h"
+
+#include <deque>
+#include <functional>
+
+// Single VK_KHR_timeline_semaphore tracking the progress of every submit on the graphics queue.
+// Each submit signals the next value; anything the GPU may still be using is released once the
+// counter passes the value it was retired at.
+class VKTimeline
+{
+public:
+	static void create(VkDevice device);
+	static void destroy();
+
+	static uint64_t nextSignalValue();
+	static uint64_t getPendingValue();
+	static uint64_t getCompletedValue();
+
+	static bool isComplete(uint64_t value);
+	static void wait(uint64_t value);
+
+	static void deferDestroy(std::function<void()> destroyFunc);
+	static void deferDestroy(uint64_t value, std::function<void()> destroyFunc);
+	static void collectGarbage();
+
+	static VkSemaphore semaphore;
+
+private:
+	struct DeferredDestroy {
+		uint64_t value;
+		std::function<void()> destroyFunc;
+	};
+
+	static VkDevice device;
+	static uint64_t pendingValue;
+	static uint64_t completedValue;
+	static std::deque<DeferredDestroy> deferred;
+
+	static PFN_vkWaitSemaphoresKHR waitSemaphores;
+	static PFN_vkGetSemaphoreCounterValueKHR getSemaphoreCounterValue;
+};
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include "VKTransientHeap.h"
+
+#include <algorithm>
+
+VkDevice VKTransientHeap::device = nullptr;
+VkPhysicalDevice VKTransientHeap::physicalDevice = nullptr;
+
+void VKTransientHeap::initDevices(VkDevice deviceIn, VkPhysicalDevice physicalDeviceIn) {
+	device = deviceIn;
+	physicalDevice = physicalDeviceIn;
+}
+
+VKTransientHeap::~VKTransientHeap() {
+	clear();
+}
+
+void VKTransientHeap::addImage(VKImage* image, uint32_t firstPass, uint32_t lastPass) {
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(device, image->image, &requirements);
+	requestedSize += requirements.size;
+
+	uint32_t memoryType;
+	if (VKImage::hasMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, &memoryType)) {
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = requirements.size;
+		allocInfo.memoryTypeIndex = memoryType;
+
+		// owned by the image, freed with it
+		VULKAN_CHECK_RESULT(vkAllocateMemory(device, &allocInfo, nullptr, &image->imageMemory), "Failed to allocate image memory!");
+		vkBindImageMemory(device, image->image, image->imageMemory, 0);
+
+		lazySize += requirements.size;
+		return;
+	}
+
+	placements.push_back({ image, requirements, firstPass, lastPass, 0 });
+}
+
+void VKTransientHeap::allocate() {
+	// biggest first, each at the lowest offset that doesn't collide with a placed image alive at the same time
+	std::sort(placements.begin(), placements.end(), [](const Placement& a, const Placement& b) {
+		return a.requirements.size > b.requirements.size;
+	});
+
+	std::vector<bool> placed(placements.size(), false);
+
+	// images that can't share a memory type go to separate blocks
+	for (size_t first = 0; first < placements.size(); first++) {
+		if (placed[first]) {
+			continue;
+		}
+
+		uint32_t memoryTypeBits = placements[first].requirements.memoryTypeBits;
+		std::vector<size_t> block;
+
+		for (size_t i = first; i < placements.size(); i++) {
+			Placement& placement = placements[i];
+			if (placed[i] || (placement.requirements.memoryTypeBits & memoryTypeBits) == 0) {
+				continue;
+			}
+
+			VkDeviceSize offset = 0;
+			bool moved = true;
+			while (moved) {
+				moved = false;
+				for (size_t j : block) {
+					const Placement& other = placements[j];
+					bool aliveTogether = placement.firstPass <= other.lastPass && other.firstPass <= placement.lastPass;
+					bool overlaps = offset < other.offset + other.requirements.size && other.offset < offset + placement.requirements.size;
+					if (aliveTogether && overlaps) {
+						VkDeviceSize alignment = placement.requirements.alignment;
+						offset = (other.offset + other.requirements.size + alignment - 1) / alignment * alignment;
+						moved = true;
+					}
+				}
+			}
+
+			placement.offset = offset;
+			memoryTypeBits &= placement.requirements.memoryTypeBits;
+			placed[i] = true;
+			block.push_back(i);
+		}
+
+		VkDeviceSize blockSize = 0;
+		for (size_t i : block) {
+			blockSize = std::max(blockSize, placements[i].offset + placements[i].requirements.size);
+		}
+
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = blockSize;
+		allocInfo.memoryTypeIndex = VKImage::findMemoryType(memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		VkDeviceMemory memory;
+		VULKAN_CHECK_RESULT(vkAllocateMemory(device, &allocInfo, nullptr, &memory), "Failed to allocate transient memory!");
+		blocks.push_back(memory);
+		allocatedSize += blockSize;
+
+		for (size_t i : block) {
+			vkBindImageMemory(device, placements[i].image->image, memory, placements[i].offset);
+		}
+	}
+
+	placements.clear();
+}
+
+void VKTransientHeap::clear() {
+	// the images must be destroyed before their memory
+	for (VkDeviceMemory memory : blocks) {
+		vkFreeMemory(device, memory, nullptr);
+	}
+	blocks.clear();
+	placements.clear();
+
+	requestedSize = 0;
+	allocatedSize = 0;
+	lazySize = 0;
+}
\ No newline at end of file
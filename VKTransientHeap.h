@@ -0,0 +1,49 @@
+#pragma once
+
+#include "VulkanContext.h"
+#include "VkImage.h"
+
+#include <vector>
+
+// Memory for attachments that only live inside a frame. Where the device has lazily allocated
+// memory an attachment gets its own lazy allocation, which tiled GPUs never back with real memory.
+// Otherwise attachments are placed in shared device local blocks, and attachments whose pass
+// lifetimes [firstPass, lastPass] don't overlap share the same bytes.
+class VKTransientHeap
+{
+public:
+	static void initDevices(VkDevice device, VkPhysicalDevice physicalDevice);
+
+	VKTransientHeap() = default;
+	~VKTransientHeap();
+
+	// image must have been created with createUnboundImage and TRANSIENT_ATTACHMENT usage
+	void addImage(VKImage* image, uint32_t firstPass, uint32_t lastPass);
+	// places and binds every image added since the last clear
+	void allocate();
+	void clear();
+
+	// bytes the attachments would take with one allocation each, and bytes actually committed
+	VkDeviceSize getRequestedSize() const { return requestedSize; }
+	VkDeviceSize getAllocatedSize() const { return allocatedSize; }
+	VkDeviceSize getLazySize() const { return lazySize; }
+
+private:
+	struct Placement {
+		VKImage* image;
+		VkMemoryRequirements requirements;
+		uint32_t firstPass;
+		uint32_t lastPass;
+		VkDeviceSize offset;
+	};
+
+	std::vector<Placement> placements;
+	std::vector<VkDeviceMemory> blocks;
+
+	VkDeviceSize requestedSize = 0;
+	VkDeviceSize allocatedSize = 0;
+	VkDeviceSize lazySize = 0;
+
+	static VkDevice device;
+	static VkPhysicalDevice physicalDevice;
+};
\ No newline at end of file
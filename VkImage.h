@@ -1,3 +1,5 @@
+#pragma once
+
 #include "VulkanContext.h"
 
 class VKImage
@@ -13,12 +15,17 @@ public:
 	void clear();
 
 	static uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+	static bool hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t* memoryType);
 	static VkSampleCountFlagBits getMaxUsableSampleCount();
 
 	void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling,
 		VkImageUsageFlags usage, VkMemoryPropertyFlags properties);
+	// image without memory, bound later by the owner of the memory (see VKTransientHeap)
+	void createUnboundImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling,
+		VkImageUsageFlags usage);
 	void createImageView(VkFormat format, VkImageAspectFlags aspectFlags);
 	static VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels);
+	// shared texture sampler from VKSamplerCache
 	void createSampler();
 
 	VkImage image = VK_NULL_HANDLE;
@@ -28,6 +35,7 @@ public:
 	VkSampler sampler = VK_NULL_HANDLE;
 
 	uint32_t mipLevels;
+	// sample count of the color and depth attachments, set from the quality tier
 	static VkSampleCountFlagBits msaaSamples;
 
 private:
@@ -1,5 +1,9 @@
 #include "VulkanApp.h"
 #include "VKCommandBuffer.h"
+#include "VKTimeline.h"
+#include "VKSamplerCache.h"
+
+#include <algorithm>
 
 VulkanApp::VulkanApp() {
 }
@@ -17,8 +21,28 @@ void VulkanApp::run() {
 
 void VulkanApp::mainLoop() {
 	while (!glfwWindowShouldClose(window)) {
+		if (framePacingChanged) {
+			applyFramePacing();
+		}
+		if (qualityChanged) {
+			applyQuality();
+		}
+		if (lightCountChanged) {
+			applyLightCount();
+		}
+		if (framePacer.justInTime) {
+			waitForPreviousFrame();
+		}
+
 		glfwPollEvents();
+		framePacer.markInputSampled();
+		reloadChangedShaders();
 		drawFrame();
+
+		FramePacingStats pacingStats;
+		if (framePacer.collectStats(&pacingStats)) {
+			printStats(pacingStats);
+		}
 	}
 	vkDeviceWaitIdle(device);
 }
@@ -30,42 +54,86 @@ void VulkanApp::initVulkan() {
 	getPhysicalDevice();
 	getLogicalDevice();
 
+	VKTimeline::create(device);
 	VKImage::initDevices(device, physicalDevice);
+	quality.maxSamples = VKImage::getMaxUsableSampleCount();
+	VKTransientHeap::initDevices(device, physicalDevice);
+	VKTextureTable::initDevices(device, physicalDevice);
+	VKDescriptorAllocator::initDevices(device);
+	VKSamplerCache::initDevices(device);
+	VKPipelineManager::initDevices(device, physicalDevice);
+	VKShaderReflection::initDevices(device);
 	VKBuffer::initDevices(device, physicalDevice);
 	VKSwapchain::init(device, physicalDevice, queueFamilyIndices);
+	VKCommandBuffer::createCommandPool(device, graphicsQueue, queueFamilyIndices.graphicsFamily.value());
+
+	// opened before anything loads shaders, the pipeline workers read from it too
+	assetArchive.tryOpen(ASSET_ARCHIVE_PATH);
+	assetCache.create(ASSET_CACHE_PATH);
+	VKShaderReflection::setAssetCache(&assetCache);
+
+	pipelineManager.loadShader = [this](const std::string& fileName) { return createShaderModule(fileName); };
+	// half the cores, the rest stay with the render and driver threads
+	pipelineManager.create("pipeline_cache.bin", std::max(1u, std::thread::hardware_concurrency() / 2));
+	shaderWatcher.watch("shaders");
+
+	textureTable.create(4096);
+	createPipelineLayout();
+	createCullPipeline();
+
+	// decoding is cpu bound, so it gets at least two workers even on small machines
+	assetIO.create(std::max(2u, std::thread::hardware_concurrency() / 2));
+	loadAssets();
+	std::cout << "Asset cache: " << assetCache.getHits() << " hit(s), " << assetCache.getMisses() << " rebuilt" << std::endl;
+	createMaterials();
+	createMaterialBuffer();
+
+	createInstances();
+	createInstanceBuffer();
+	createObjectBuffer();
+
+	createFrameContexts();
 
 	initVulkanForSwapchain();
 
-	createSyncObjects();
+	framePacingChanged = false;
+	qualityChanged = false;
+	lightCountChanged = false;
 }
 
 void VulkanApp::initVulkanForSwapchain() {
+	swapchain.preferredPresentModes = framePacer.presentModes;
+	swapchain.extraImageCount = framePacer.extraSwapchainImages;
 	swapchain.createSwapChain();
 	swapchain.createImageViews();
 
-	createDescriptorSetLayout();
-	createPipelineLayout();
+	createRenderTargets();
+
+	imagesInFlight.assign(swapchain.images.size(), 0);
+}
+
+void VulkanApp::createRenderTargets() {
+	VKImage::msaaSamples = quality.getSamples();
+
 	createRenderPass();
 	createGraphicsPipeline();
 
-	VKCommandBuffer::createCommandPool(device, graphicsQueue, queueFamilyIndices.graphicsFamily.value());
-	createColorResources();
-	createDepthResources();
-	swapchain.createFramebuffers(renderPass, colorImage, depthImage);
-	
-	createTextureImage(TEXTURE_PATH.c_str(), &textureImage);
-	createTextureImage(NORMAL_TEXTURE_PATH.c_str(), &normalImage);
-	createTextureImage(SPECULAR_TEXTURE_PATH.c_str(), &specularImage);
+	createTransientResources();
+	createSceneResources();
+}
 
-	loadModel();
-	createVertexBuffer();
-	createIndexBuffer();
-	createUniformBuffers();
+void VulkanApp::destroyRenderTargets() {
+	vkDestroyFramebuffer(device, sceneFramebuffer, nullptr);
+	sceneFramebuffer = VK_NULL_HANDLE;
 
-	createDescriptorPool();
-	createDescriptorSets();
+	sceneColor.clear();
+	colorImage.clear();
+	depthImage.clear();
+	transientHeap.clear();
 
-	VKCommandBuffer::createCommandBuffers(swapchain.framebuffers, renderPass, pipeline, pipelineLayout, descriptorSets, swapchain.extent, vertexBuffer.buffer, indexBuffer.buffer, indices);
+	// every graphics pipeline was built against this render pass, createGraphicsPipeline compiles the groups' again
+	pipelineManager.clearPipelines();
+	vkDestroyRenderPass(device, renderPass, nullptr);
 }
 
 void VulkanApp::recreateSwapChain() {
@@ -76,23 +144,161 @@ void VulkanApp::recreateSwapChain() {
 	}
 
 	vkDeviceWaitIdle(device);
+	VKTimeline::collectGarbage();
 
 	cleanupSwapChain();
 
 	initVulkanForSwapchain();
 }
 
+void VulkanApp::setFramePacingProfile(FramePacingProfile profile) {
+	framePacer.setProfile(profile);
+	framePacingChanged = true;
+}
+
+void VulkanApp::toggleFramePacingProfile() {
+	setFramePacingProfile(framePacer.getProfile() == FramePacingProfile::Throughput ? FramePacingProfile::Latency : FramePacingProfile::Throughput);
+}
+
+void VulkanApp::setScenePath(const std::string& path) {
+	scenePath = path;
+}
+
+void VulkanApp::setInstanceCount(uint32_t count) {
+	instanceCount = std::max(count, 1u);
+}
+
+void VulkanApp::setTargetFrameTime(float milliseconds) {
+	resolutionController.targetFrameTimeMs = milliseconds;
+}
+
+void VulkanApp::toggleDynamicResolution() {
+	resolutionController.enabled = !resolutionController.enabled;
+	std::cout << "Dynamic resolution: " << (resolutionController.enabled ? "on" : "off") << std::endl;
+}
+
+void VulkanApp::applyFramePacing() {
+	framePacingChanged = false;
+
+	vkDeviceWaitIdle(device);
+	destroyFrameContexts();
+	currentFrame = 0;
+	createFrameContexts();
+
+	recreateSwapChain();
+
+	std::cout << "Frame pacing: " << framePacer.getProfileName() << ", " << framePacer.framesInFlight << " frame(s) in flight" << std::endl;
+}
+
+void VulkanApp::setQualityTier(QualityTier tier) {
+	pendingQualityTier = tier;
+	qualityChanged = true;
+}
+
+void VulkanApp::cycleQualityTier() {
+	setQualityTier(VKQuality::getNextTier(qualityChanged ? pendingQualityTier : quality.getTier()));
+}
+
+void VulkanApp::applyQuality() {
+	qualityChanged = false;
+
+	// only the attachments, render pass, framebuffers and graphics pipeline depend on the sample count
+	vkDeviceWaitIdle(device);
+	VKTimeline::collectGarbage();
+	quality.setTier(pendingQualityTier);
+
+	destroyRenderTargets();
+	createRenderTargets();
+
+	std::cout << "Quality: " << quality.getTierName() << ", " << quality.getSamples() << "x MSAA, sample shading "
+		<< (quality.sampleShading ? "on" : "off") << std::endl;
+}
+
+void VulkanApp::setDepthPrepass(bool enabled) {
+	// takes effect once its pipelines are compiled, nothing has to be rebuilt
+	depthPrepass = enabled;
+}
+
+void VulkanApp::toggleDepthPrepass() {
+	setDepthPrepass(!depthPrepass);
+	std::cout << "Depth pre-pass: " << (depthPrepass ? "on" : "off") << std::endl;
+}
+
+void VulkanApp::setLightCount(uint32_t count) {
+	lightCount = std::min(std::max(count, 1u), MAX_LIGHTS);
+	lightCountChanged = true;
+}
+
+void VulkanApp::cycleLightCount() {
+	setLightCount(lightCount % MAX_LIGHTS + 1);
+}
+
+void VulkanApp::applyLightCount() {
+	lightCountChanged = false;
+
+	// groups keep drawing with the previous light count until their new variant has compiled
+	createShadingPipelineDescs();
+
+	std::cout << "Lights: " << lightCount << std::endl;
+}
+
+void VulkanApp::reloadChangedShaders() {
+	for (const std::string& fileName : shaderWatcher.poll()) {
+		// a half written or broken shader keeps the running pipelines, the next save tries again
+		try {
+			// descriptor sets are built for the current layouts, a shader that changes them needs a restart;
+			// other bindings match no existing layout, and none is created for them
+			bool isCull = fileName == "shaders/cull.spirv";
+			VkPipelineLayout layout = isCull ? reflectCullPipelineLayout(false).layout : reflectPipelineLayout(false).layout;
+			if (layout != (isCull ? cullPipelineLayout : pipelineLayout)) {
+				std::cout << fileName << " changed its bindings, restart to apply" << std::endl;
+				continue;
+			}
+
+			if (isCull) {
+				// one compute pipeline, cheap enough to rebuild right here
+				VkPipeline oldPipeline = cullPipeline;
+				createCullPipeline();
+				VkDevice deviceCopy = device;
+				VKTimeline::deferDestroy([deviceCopy, oldPipeline]() {
+					vkDestroyPipeline(deviceCopy, oldPipeline, nullptr);
+				});
+				std::cout << "Reloaded " << fileName << std::endl;
+				continue;
+			}
+
+			size_t queued = pipelineManager.reloadShader(fileName);
+			if (queued != 0) {
+				std::cout << "Recompiling " << queued << " pipeline(s) using " << fileName << std::endl;
+			}
+		}
+		catch (const std::exception& e) {
+			std::cerr << "Reloading " << fileName << " failed: " << e.what() << std::endl;
+		}
+	}
+
+	// recompiles that finished since the last frame replace their pipelines before this one is recorded
+	size_t swapped = pipelineManager.swapReloadedPipelines();
+	if (swapped != 0) {
+		std::cout << "Reloaded " << swapped << " pipeline(s)" << std::endl;
+	}
+}
+
+void VulkanApp::printStats(const FramePacingStats& pacingStats) {
+	std::cout << pacingStats.fps << " fps, " << pacingStats.frameTimeMs << " ms/frame, input-to-present "
+		<< pacingStats.latencyMs << " ms (max " << pacingStats.maxLatencyMs << " ms), attachments "
+		<< attachmentBandwidth / (1024.0f * 1024.0f) << " MB/frame, gpu " << resolutionController.getGpuTimeMs() << " ms, render "
+		<< renderExtent.width << "x" << renderExtent.height << " (" << resolutionController.getScale() * 100.f << "%), "
+		<< fragmentsPerPixel << " shaded fragments per pixel" << (depthPrepassActive ? " with" : " without") << " depth pre-pass, "
+		<< pipelineManager.getPendingCount() << " pipelines compiling" << std::endl;
+}
+
 void VulkanApp::cleanupSwapChain() {
 	/*for (size_t i = 0; i < framebuffers.size(); i++) {
 		vkDestroyFramebuffer(device, framebuffers[i], nullptr);
 	}*/
 
-	VKCommandBuffer::freeCommandBuffers();
-
-	vkDestroyPipeline(device, pipeline, nullptr);
-	vkDestroyRenderPass(device, renderPass, nullptr);
-	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+	destroyRenderTargets();
 
 	/*for (size_t i = 0; i < imageViews.size(); i++) {
 		vkDestroyImageView(device, imageViews[i], nullptr);
@@ -103,27 +309,29 @@ void VulkanApp::cleanupSwapChain() {
 }
 
 void VulkanApp::cleanup() {
-	colorImage.clear();
-	depthImage.clear();
-
 	cleanupSwapChain();
 
-	textureImage.clear();
-	normalImage.clear();
-	specularImage.clear();
+	destroyFrameContexts();
+
+	textures.clear();
+	textureTable.clear();
+	VKSamplerCache::destroy();
+	materialBuffer.clear();
 
+	objectBuffer.clear();
+	instanceBuffer.clear();
 	indexBuffer.clear();
+	positionBuffer.clear();
 	vertexBuffer.clear();
-	for (size_t i = 0; i < swapchain.images.size(); i++) {
-		uniformBuffers[i].clear();
-	}
-	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
 
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
-		vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
-		vkDestroyFence(device, inFlightFences[i], nullptr);
-	}
+	vkDestroyPipeline(device, cullPipeline, nullptr);
+	VKShaderReflection::destroy();
+
+	shaderWatcher.stop();
+	assetIO.destroy();
+	pipelineManager.destroy();
+	assetArchive.close();
+	VKTimeline::destroy();
 	VKCommandBuffer::destroyCommandPool();
 
 	if (enableValidationLayers) {
@@ -1,6 +1,20 @@
 #include "VulkanContext.h"
 #include "VKBuffer.h"
 #include "VKSwapchain.h"
+#include "VKFramePacer.h"
+#include "VKRenderGraph.h"
+#include "VKTransientHeap.h"
+#include "VKQuality.h"
+#include "VKResolutionController.h"
+#include "VKTextureTable.h"
+#include "VKDescriptorAllocator.h"
+#include "VKPipelineManager.h"
+#include "VKShaderReflection.h"
+#include "VKShaderWatcher.h"
+#include "VKAsyncIO.h"
+#include "VKAssetArchive.h"
+#include "VKAssetCache.h"
+#include "VKScene.h"
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/hash.hpp>
@@ -10,11 +24,20 @@
 #include <iostream>
 #include <optional>
 #include <array>
+#include <memory>
 
+// the built-in scene, used when no scene file is given
 const std::string MODEL_PATH = "models/african_head.obj";
 const std::string TEXTURE_PATH = "textures/african_head_diffuse.jpg";
 const std::string NORMAL_TEXTURE_PATH = "textures/african_head_nm.jpg";
 const std::string SPECULAR_TEXTURE_PATH = "textures/african_head_spec.jpg";
+// built by tools/pack_assets, the loose files are used when it is missing
+const std::string ASSET_ARCHIVE_PATH = "assets.pack";
+// processed meshes, mip chains and shader reflections from earlier runs
+const std::string ASSET_CACHE_PATH = "asset_cache";
+
+// size of the light array in fragment.spirv
+const uint32_t MAX_LIGHTS = 4;
 
 const std::vector<const char*> validationLayers = {
 	"VK_LAYER_LUNARG_standard_validation"
@@ -22,44 +45,22 @@ const std::vector<const char*> validationLayers = {
 };
 
 const std::vector<const char*> deviceExtensions = {
-	VK_KHR_SWAPCHAIN_EXTENSION_NAME
+	VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+	VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME,
+	VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME
+};
+
+// enabled when present, the renderer falls back to a plain path otherwise
+const std::vector<const char*> optionalDeviceExtensions = {
+	VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME
 };
 
+// interleaved in the location order of vertex.spirv's inputs, the vertex input state is reflected from it
 struct Vertex {
 	glm::vec3 pos;
 	glm::vec3 color;
 	glm::vec2 texCoord;
 
-	static VkVertexInputBindingDescription getBindingDescription() {
-		VkVertexInputBindingDescription bindingDescription = {};
-		bindingDescription.binding = 0;
-		bindingDescription.stride = sizeof(Vertex);
-		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-		return bindingDescription;
-	}
-
-	static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
-		std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions = {};
-
-		attributeDescriptions[0].binding = 0;
-		attributeDescriptions[0].location = 0;
-		attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[0].offset = offsetof(Vertex, pos);
-
-		attributeDescriptions[1].binding = 0;
-		attributeDescriptions[1].location = 1;
-		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-		attributeDescriptions[2].binding = 0;
-		attributeDescriptions[2].location = 2;
-		attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-		attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
-
-		return attributeDescriptions;
-	}
-
 	bool operator==(const Vertex& other) const {
 		return pos == other.pos && color == other.color && texCoord == other.texCoord;
 	}
@@ -75,12 +76,121 @@ namespace std {
 	};
 }
 
+// one mesh as loaded, before it is merged into the shared buffers
+struct MeshData {
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	// xyz center, w radius
+	glm::vec4 bounds;
+};
+
+// where a mesh sits in the shared vertex and index buffers
+struct SceneMesh {
+	int32_t vertexOffset;
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	// xyz center, w radius, in model space
+	glm::vec4 bounds;
+};
+
+// per frame, per-object data is in the instance buffer
 struct UniformBufferObject {
-	glm::mat4 model;
 	glm::mat4 view;
 	glm::mat4 proj;
 };
 
+// per-instance data, read in the vertex shader through gl_InstanceIndex
+struct InstanceData {
+	glm::mat4 model;
+	uint32_t material;
+	uint32_t padding[3];
+};
+
+// what a material's textures are used for, selects the fragment shader variant it is drawn with
+enum MaterialFeature : uint32_t {
+	MaterialNormalMap = 1,
+	MaterialSpecular = 2
+};
+
+// indices into the texture table, matching MaterialData in fragment.spirv
+struct MaterialData {
+	uint32_t diffuseTexture;
+	uint32_t normalTexture;
+	uint32_t specularTexture;
+	// MaterialFeature bits, only read on the CPU
+	uint32_t features;
+};
+
+// one drawable for the culling pass: bounding sphere in model space, index range and the instance it draws
+struct ObjectData {
+	glm::vec4 boundingSphere;
+	uint32_t indexCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t instanceIndex;
+	// draw slots of a group start at firstDraw, compacted draws are counted per group
+	uint32_t drawGroup;
+	uint32_t firstDraw;
+	uint32_t padding[2];
+};
+
+// objects whose materials share a shading variant; they have consecutive draw slots and one indirect draw
+struct DrawGroup {
+	uint32_t features;
+	uint32_t firstObject;
+	uint32_t objectCount;
+	VKPipelineDesc shadingPipelineDesc;
+	VKPipelineDesc prepassShadingPipelineDesc;
+	// the most recent variant that finished compiling, drawn with while a new one compiles; looked up
+	// in the pipeline manager every frame, a shader reload replaces the pipeline behind it
+	VKPipelineDesc readyPipelineDesc;
+};
+
+// scene transform pushed once per pass, shared by the graphics pipelines through pipelineLayout.
+// Objects are drawn by indirect commands the cull pass writes, many per call, so per-object data
+// can't be pushed; the shaders index the instance buffer with the firstInstance the cull pass set
+struct DrawPushConstants {
+	glm::mat4 model;
+};
+
+struct CullPushConstants {
+	glm::mat4 model;
+	uint32_t objectCount;
+	// 1: append visible draws and use the count buffer, 0: keep one slot per object and zero culled ones
+	uint32_t compact;
+};
+
+// render graph passes in recording order, transient attachment lifetimes are given in these
+enum class FramePass : uint32_t {
+	ClearDrawCount,
+	Cull,
+	Main
+};
+
+// everything the CPU writes while building a frame; indexed by currentFrame, so waiting for
+// the frame slot's timeline value is enough to reuse all of it
+struct FrameContext {
+	VKBuffer uniformBuffer;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+
+	// written by the culling pass, consumed by the indirect draw of the same frame
+	VKBuffer drawCommandBuffer;
+	VKBuffer drawCountBuffer;
+	VkDescriptorSet cullDescriptorSet = VK_NULL_HANDLE;
+
+	VkSemaphore imageAvailableSemaphore = VK_NULL_HANDLE;
+	VkSemaphore renderFinishedSemaphore = VK_NULL_HANDLE;
+	uint64_t timelineValue = 0;
+
+	// start and end of the command buffer, read back once the frame's timeline value is reached
+	VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+	bool timestampsWritten = false;
+	// fragment shader invocations of the shading draw
+	VkQueryPool statisticsQueryPool = VK_NULL_HANDLE;
+	bool statisticsWritten = false;
+};
+
 VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo,
 	const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger);
 
@@ -88,8 +198,6 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
 
 void framebufferResizeCallback(GLFWwindow* window, int width, int height);
 
-std::vector<char> readFile(const std::string& filename);
-
 class VulkanApp
 {
 public:
@@ -102,11 +210,33 @@ public:
 	void initWindow();
 	void cleanup();
 
+	void setFramePacingProfile(FramePacingProfile profile);
+	void toggleFramePacingProfile();
+
+	void setQualityTier(QualityTier tier);
+	void cycleQualityTier();
+
+	// a scene file to load instead of the built-in scene
+	void setScenePath(const std::string& path);
+	// copies of the model in the built-in scene
+	void setInstanceCount(uint32_t count);
+
+	void setTargetFrameTime(float milliseconds);
+	void toggleDynamicResolution();
+
+	void setDepthPrepass(bool enabled);
+	void toggleDepthPrepass();
+
+	void setLightCount(uint32_t count);
+	void cycleLightCount();
+
 private:
 
 	//---------init---------------------------------------------
 
 	void initVulkanForSwapchain();
+	void createRenderTargets();
+	void destroyRenderTargets();
 
 	std::vector<const char*> getRequiredExtensions();
 	bool checkValidationLayerSupport();
@@ -123,6 +253,7 @@ private:
 
 	QueueFamilyIndices findQueueFamilies(VkPhysicalDevice physicalDevice);
 	bool checkDeviceExtensionSupport(VkPhysicalDevice physicalDevice);
+	std::vector<const char*> getEnabledDeviceExtensions();
 	bool isDeviceSuitable(VkPhysicalDevice physicalDevice);
 
 	void getPhysicalDevice();
@@ -133,39 +264,76 @@ private:
 	void recreateSwapChain();
 	void cleanupSwapChain();
 
+	void applyFramePacing();
+	void applyQuality();
+	void applyLightCount();
+	void reloadChangedShaders();
+	void waitForPreviousFrame();
+	void printStats(const FramePacingStats& pacingStats);
+
 	//---------graphics----------------------------------------
 
+	VKAssetData openShader(const std::string& fileName);
 	VkShaderModule createShaderModule(const std::string fileName);
-	void createDescriptorSetLayout();
+	const VKShaderLayout& reflectShader(const std::string fileName, VkShaderStageFlagBits stage);
+	// with create false only an existing layout is returned, see VKShaderReflection::getPipelineLayout
+	VKReflectedPipelineLayout reflectPipelineLayout(bool create = true);
+	VKReflectedPipelineLayout reflectCullPipelineLayout(bool create = true);
 	void createPipelineLayout();
 	void createRenderPass();
 	void createGraphicsPipeline();
+	VKPipelineDesc getShadingPipelineDesc(bool afterDepthPrepass, uint32_t features);
+	void createShadingPipelineDescs();
+	VKPipelineDesc getDepthPipelineDesc();
+
+	void createCullPipeline();
 
 	//---------drawing----------------------------------------
 	
 	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
 
-	void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
-	void generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
+	// copies every mip level, packed one after the other in the buffer
+	void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels);
 
-	void createTextureImage(const char* filename, VKImage* image);
+	void loadAssets();
+	void loadSceneAssets(std::vector<MeshData>& meshData);
+	VKScene createDefaultScene();
+	void readAsset(const std::string& fileName, VKAsyncIO::DecodeFunc decode);
+	void loadTextureImage(const std::string& filename, VKImage* image);
+	std::vector<char> loadTexture(const char* data, size_t size);
+	void createTextureImage(const std::vector<char>& texture, VKImage* image);
+	void createMaterials();
+	void createMaterialBuffer();
 
 	VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 	VkFormat findDepthFormat();
 	bool hasStencilComponent(VkFormat format);
 	void createColorResources();
 	void createDepthResources();
+	void createTransientResources();
+	void createSceneResources();
 	
-	void loadModel();
+	MeshData loadMesh(const char* data, size_t size);
+	void createMeshBuffers(const std::vector<MeshData>& meshData);
 	void createVertexBuffer();
+	void createPositionBuffer();
 	void createIndexBuffer();
+	void createInstances();
+	void createInstanceBuffer();
+	void createObjectBuffer();
 	void createUniformBuffers();
-	void updateUniformBuffer(uint32_t currentImage);
+	void updateUniformBuffer(FrameContext& frame);
 
-	void createDescriptorPool();
 	void createDescriptorSets();
-
-	void createSyncObjects();
+	void createCullDescriptorSets();
+
+	void createFrameContexts();
+	void destroyFrameContexts();
+	void recordCulling(FrameContext& frame, VkCommandBuffer commandBuffer);
+	void recordMainPass(FrameContext& frame, VkCommandBuffer commandBuffer);
+	void recordUpscale(uint32_t imageIndex, VkCommandBuffer commandBuffer);
+	void readFrameQueries(FrameContext& frame);
+	void recordCommandBuffer(FrameContext& frame, uint32_t imageIndex);
 	void drawFrame();
 
 	//----------------------------------------------------------
@@ -182,34 +350,107 @@ private:
 	GLFWwindow* window = nullptr;
 	VKSwapchain swapchain;
 
+	// reflected from the shaders and owned by VKShaderReflection, like the cull layouts
 	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
 	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkShaderStageFlags drawPushConstantStages = 0;
 	VkRenderPass renderPass = VK_NULL_HANDLE;
-	VkPipeline pipeline = VK_NULL_HANDLE;
-
-	VKImage textureImage;
-	VKImage normalImage;
-	VKImage specularImage;
+	// bytes the render pass loads and stores per frame
+	VkDeviceSize attachmentBandwidth = 0;
+	VKPipelineManager pipelineManager;
+	VKShaderWatcher shaderWatcher;
+	VKAsyncIO assetIO;
+	VKAssetArchive assetArchive;
+	VKAssetCache assetCache;
+	// depth only, fills the depth buffer so the shading pipelines run once per visible sample
+	VKPipelineDesc depthPipelineDesc;
+	bool depthPrepass = false;
+	// false while the pre-pass pipelines are still compiling
+	bool depthPrepassActive = false;
+
+	VkDescriptorSetLayout cullDescriptorSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline cullPipeline = VK_NULL_HANDLE;
+
+	bool drawIndirectCountSupported = false;
+	PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount = nullptr;
+
+	// empty for the built-in scene
+	std::string scenePath;
+	VKScene scene;
+
+	// one per scene texture
+	std::vector<std::unique_ptr<VKImage>> textures;
+	VKTextureTable textureTable;
+
+	std::vector<MaterialData> materials;
+	VKBuffer materialBuffer;
 	
 	VKImage colorImage;
 	VKImage depthImage;
-
+	VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+	VKTransientHeap transientHeap;
+
+	// the main pass renders into the top left renderExtent of sceneColor, which is then scaled onto the swapchain image
+	VKImage sceneColor;
+	VkFramebuffer sceneFramebuffer = VK_NULL_HANDLE;
+	VkExtent2D renderExtent = {};
+	VkFilter upscaleFilter = VK_FILTER_LINEAR;
+	// without blit support sceneColor is copied, so the render scale stays at 100%
+	bool upscaleSupported = true;
+
+	// every mesh of the scene, one after the other
 	std::vector<Vertex> vertices;
 	std::vector<uint32_t> indices;
+	std::vector<SceneMesh> meshes;
 
 	VKBuffer vertexBuffer;
+	VKBuffer positionBuffer;
 	VKBuffer indexBuffer;
-	std::vector<VKBuffer> uniformBuffers = {};
 
-	VkDescriptorPool descriptorPool;
-	std::vector<VkDescriptorSet> descriptorSets;
+	uint32_t instanceCount = 1;
+	std::vector<InstanceData> instances;
+	VKBuffer instanceBuffer;
+
+	std::vector<ObjectData> objects;
+	VKBuffer objectBuffer;
+	std::vector<DrawGroup> drawGroups;
+
+	// lights the fragment shader loops over, a specialization constant like the material features
+	uint32_t lightCount = 1;
+	bool lightCountChanged = false;
 
-	std::vector<VkSemaphore> imageAvailableSemaphores;
-	std::vector<VkSemaphore> renderFinishedSemaphores;
-	std::vector<VkFence> inFlightFences;
+	VKDescriptorAllocator descriptorAllocator;
+
+	// pushed with every draw, the model matrix is updated each frame
+	DrawPushConstants drawConstants = {};
+
+	std::vector<FrameContext> frames;
+	// timeline value of the last frame that rendered into each swapchain image
+	std::vector<uint64_t> imagesInFlight;
 	
 	size_t currentFrame = 0;
 
+	VKRenderGraph renderGraph;
+
+	VKFramePacer framePacer;
+	bool framePacingChanged = false;
+
+	VKQuality quality;
+	// the key callback runs while a frame is being set up, applyQuality switches to it between frames
+	QualityTier pendingQualityTier = QualityTier::Ultra;
+	bool qualityChanged = false;
+
+	VKResolutionController resolutionController;
+	bool timestampsSupported = false;
+	// nanoseconds per timestamp tick
+	float timestampPeriod = 1.f;
+
+	bool pipelineStatisticsSupported = false;
+	// fragment shader invocations per rendered pixel and shaded sample. The whole render area counts,
+	// so this is screen coverage times overdraw: compare it between modes on the same view
+	float fragmentsPerPixel = 0.f;
+
 public:
 	bool framebufferResized = false;
 };
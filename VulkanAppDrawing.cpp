@@ -1,5 +1,9 @@
 #include "VulkanApp.h"
 #include "VKCommandBuffer.h"
+#include "VKTimeline.h"
+#include "VKRenderGraph.h"
+#include "VKSamplerCache.h"
+#include "VKMappedFile.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -14,6 +18,15 @@
 
 #include <chrono>
 #include <unordered_map>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+namespace {
+	// bump when the processing changes, every cached entry made by the old code then misses
+	const uint32_t MeshCacheVersion = 1;
+	const uint32_t TextureCacheVersion = 1;
+}
 
 VkFormat VulkanApp::findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) {
 	for (VkFormat format : candidates) {
@@ -44,23 +57,74 @@ bool VulkanApp::hasStencilComponent(VkFormat format) {
 }
 
 void VulkanApp::createColorResources() {
-	VkFormat colorFormat = swapchain.imageFormat;
+	colorImage.createUnboundImage(swapchain.extent.width, swapchain.extent.height, 1, VKImage::msaaSamples, swapchain.imageFormat, VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+	transientHeap.addImage(&colorImage, static_cast<uint32_t>(FramePass::Main), static_cast<uint32_t>(FramePass::Main));
+}
 
-	colorImage.createImage(swapchain.extent.width, swapchain.extent.height, 1, VKImage::msaaSamples, colorFormat, VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	colorImage.createImageView(colorFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+void VulkanApp::createDepthResources() {
+	depthFormat = findDepthFormat();
 
-	transitionImageLayout(colorImage.image, colorFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
+	depthImage.createUnboundImage(swapchain.extent.width, swapchain.extent.height, 1, VKImage::msaaSamples, depthFormat, VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+	transientHeap.addImage(&depthImage, static_cast<uint32_t>(FramePass::Main), static_cast<uint32_t>(FramePass::Main));
 }
 
-void VulkanApp::createDepthResources() {
-	VkFormat depthFormat = findDepthFormat();
+void VulkanApp::createTransientResources() {
+	// without multisampling the scene image is rendered to directly
+	if (quality.resolves()) {
+		createColorResources();
+	}
+	createDepthResources();
+	transientHeap.allocate();
 
-	depthImage.createImage(swapchain.extent.width, swapchain.extent.height, 1, VKImage::msaaSamples, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (quality.resolves()) {
+		colorImage.createImageView(swapchain.imageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+	}
 	depthImage.createImageView(depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
 
-	transitionImageLayout(depthImage.image, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1);
+	const VkDeviceSize megabyte = 1024 * 1024;
+	std::cout << "Transient attachments: " << transientHeap.getRequestedSize() / megabyte << " MB requested, "
+		<< transientHeap.getLazySize() / megabyte << " MB lazily allocated, "
+		<< transientHeap.getAllocatedSize() / megabyte << " MB committed" << std::endl;
+}
+
+void VulkanApp::createSceneResources() {
+	// full size so the render scale can change every frame without reallocating
+	sceneColor.createImage(swapchain.extent.width, swapchain.extent.height, 1, VK_SAMPLE_COUNT_1_BIT, swapchain.imageFormat, VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	sceneColor.createImageView(swapchain.imageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+
+	std::vector<VkImageView> attachments;
+	if (quality.resolves()) {
+		attachments = { colorImage.imageView, depthImage.imageView, sceneColor.imageView };
+	}
+	else {
+		attachments = { sceneColor.imageView, depthImage.imageView };
+	}
+
+	VkFramebufferCreateInfo info = {};
+	info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	info.renderPass = renderPass;
+	info.attachmentCount = static_cast<uint32_t>(attachments.size());
+	info.pAttachments = attachments.data();
+	info.width = swapchain.extent.width;
+	info.height = swapchain.extent.height;
+	info.layers = 1;
+
+	VULKAN_CHECK_RESULT(vkCreateFramebuffer(device, &info, nullptr, &sceneFramebuffer), "Failed to create framebuffer!");
+
+	// sceneColor has the swapchain format, so one format has to support both ends of the blit, and the linear filter
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, swapchain.imageFormat, &properties);
+	VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+	upscaleSupported = (properties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+	upscaleFilter = (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+	if (!upscaleSupported) {
+		std::cout << "Swap chain format can't be blitted, rendering at native resolution" << std::endl;
+	}
+
+	renderExtent = swapchain.extent;
 }
 
 void  VulkanApp::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels) {
@@ -74,7 +138,7 @@ void  VulkanApp::transitionImageLayout(VkImage image, VkFormat format, VkImageLa
 	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 	barrier.image = image;
 
-	if (newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
+	if (VKRenderGraph::getLayoutUsage(newLayout) == VKResourceUsage::DepthAttachment) {
 		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
 
 		if (hasStencilComponent(format)) {
@@ -90,39 +154,15 @@ void  VulkanApp::transitionImageLayout(VkImage image, VkFormat format, VkImageLa
 	barrier.subresourceRange.baseArrayLayer = 0;
 	barrier.subresourceRange.layerCount = 1;
 
-	VkPipelineStageFlags sourceStage;
-	VkPipelineStageFlags destinationStage;
-
-	if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-		sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-	}
-	else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	const VKUsageInfo& source = VKRenderGraph::getUsageInfo(VKRenderGraph::getLayoutUsage(oldLayout));
+	const VKUsageInfo& destination = VKRenderGraph::getUsageInfo(VKRenderGraph::getLayoutUsage(newLayout));
 
-		sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	}
-	else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	// the old contents only need to be made available if the old layout was written to
+	barrier.srcAccessMask = source.writeLayout == oldLayout ? source.writeAccess : 0;
+	barrier.dstAccessMask = destination.writeLayout == newLayout ? destination.writeAccess : destination.readAccess;
 
-		sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		destinationStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	}
-	else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) {
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		destinationStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	}
-	else {
-		CHECK_RESULT(true, "Unsupported layout transition!");
-	}
+	VkPipelineStageFlags sourceStage = source.stage;
+	VkPipelineStageFlags destinationStage = destination.stage;
 
 	vkCmdPipelineBarrier(
 		commandBuffer,
@@ -136,131 +176,201 @@ void  VulkanApp::transitionImageLayout(VkImage image, VkFormat format, VkImageLa
 	VKCommandBuffer::endSingleTimeCommands(commandBuffer);
 }
 
-void VulkanApp::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
+void VulkanApp::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels) {
 	VkCommandBuffer commandBuffer = VKCommandBuffer::beginSingleTimeCommands();
 
-	VkBufferImageCopy region = {};
-	region.bufferOffset = 0;
-	region.bufferRowLength = 0;
-	region.bufferImageHeight = 0;
-
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.mipLevel = 0;
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = 1;
-
-	region.imageOffset = { 0, 0, 0 };
-	region.imageExtent = {
-		width,
-		height,
-		1
-	};
+	std::vector<VkBufferImageCopy> regions(mipLevels);
+	VkDeviceSize offset = 0;
+	for (uint32_t level = 0; level < mipLevels; level++) {
+		VkBufferImageCopy& region = regions[level];
+		region.bufferOffset = offset;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = level;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = {
+			width,
+			height,
+			1
+		};
+
+		offset += VkDeviceSize(width) * height * 4;
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+	}
 
 	vkCmdCopyBufferToImage(
 		commandBuffer,
 		buffer,
 		image,
 		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		1,
-		&region
+		static_cast<uint32_t>(regions.size()),
+		regions.data()
 	);
 
 	VKCommandBuffer::endSingleTimeCommands(commandBuffer);
 }
 
+void VulkanApp::loadAssets() {
+	std::vector<MeshData> meshData;
 
+	if (scenePath.empty()) {
+		scene = createDefaultScene();
+		loadSceneAssets(meshData);
+	}
+	else {
+		// the scene file is read like any other asset, its textures and meshes follow as soon as it is parsed
+		readAsset(scenePath, [this, &meshData](const char* data, size_t size) {
+			scene = VKScene::parse(data, size, scenePath);
+			assetIO.runOnMainThread([this, &meshData]() {
+				loadSceneAssets(meshData);
+			});
+		});
+	}
 
-void VulkanApp::generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) {
-	VkFormatProperties formatProperties;
-	vkGetPhysicalDeviceFormatProperties(physicalDevice, imageFormat, &formatProperties);
+	assetIO.waitIdle();
+	createMeshBuffers(meshData);
+}
 
-	CHECK_RESULT((formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT), "Texture image format does not support linear blitting!");
+// every file is read and decoded at the same time, the uploads run on the main thread as each one is ready
+void VulkanApp::loadSceneAssets(std::vector<MeshData>& meshData) {
+	textures.clear();
+	for (const std::string& path : scene.texturePaths) {
+		textures.push_back(std::make_unique<VKImage>());
+		loadTextureImage(path, textures.back().get());
+	}
 
-	VkCommandBuffer commandBuffer = VKCommandBuffer::beginSingleTimeCommands();
+	// sized up front, the workers fill in their own element
+	meshData.resize(scene.meshPaths.size());
+	for (size_t i = 0; i < scene.meshPaths.size(); i++) {
+		MeshData* mesh = &meshData[i];
+		readAsset(scene.meshPaths[i], [this, mesh](const char* data, size_t size) {
+			*mesh = loadMesh(data, size);
+		});
+	}
+}
 
-	VkImageMemoryBarrier barrier = {};
-	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	barrier.image = image;
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = 1;
-	barrier.subresourceRange.levelCount = 1;
-
-	int32_t mipWidth = texWidth;
-	int32_t mipHeight = texHeight;
-
-	for (uint32_t i = 1; i < mipLevels; i++) {
-		barrier.subresourceRange.baseMipLevel = i - 1;
-		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-		vkCmdPipelineBarrier(commandBuffer,
-			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-			0, nullptr,
-			0, nullptr,
-			1, &barrier);
-
-		VkImageBlit blit = {};
-		blit.srcOffsets[0] = { 0, 0, 0 };
-		blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
-		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		blit.srcSubresource.mipLevel = i - 1;
-		blit.srcSubresource.baseArrayLayer = 0;
-		blit.srcSubresource.layerCount = 1;
-		blit.dstOffsets[0] = { 0, 0, 0 };
-		blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
-		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		blit.dstSubresource.mipLevel = i;
-		blit.dstSubresource.baseArrayLayer = 0;
-		blit.dstSubresource.layerCount = 1;
-
-		vkCmdBlitImage(commandBuffer,
-			image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1, &blit,
-			VK_FILTER_LINEAR);
-
-		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-		vkCmdPipelineBarrier(commandBuffer,
-			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-			0, nullptr,
-			0, nullptr,
-			1, &barrier);
-
-		if (mipWidth > 1) mipWidth /= 2;
-		if (mipHeight > 1) mipHeight /= 2;
-	}
-
-	barrier.subresourceRange.baseMipLevel = mipLevels - 1;
-	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-	vkCmdPipelineBarrier(commandBuffer,
-		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-		0, nullptr,
-		0, nullptr,
-		1, &barrier);
+// the built-in scene: the model with three materials, each drawn with its own shader variant;
+// instanceCount copies on a cube grid scaled to the volume of a single model,
+// so one instance looks exactly like before and a thousand still fit the view
+VKScene VulkanApp::createDefaultScene() {
+	VKScene defaultScene;
+	uint32_t mesh = defaultScene.addMesh(MODEL_PATH);
+	uint32_t diffuse = defaultScene.addTexture(TEXTURE_PATH);
+	int32_t normal = static_cast<int32_t>(defaultScene.addTexture(NORMAL_TEXTURE_PATH));
+	int32_t specular = static_cast<int32_t>(defaultScene.addTexture(SPECULAR_TEXTURE_PATH));
+
+	defaultScene.addMaterial({ diffuse, normal, specular });
+	defaultScene.addMaterial({ diffuse, normal, -1 });
+	defaultScene.addMaterial({ diffuse, -1, -1 });
+
+	uint32_t side = 1;
+	while (side * side * side < instanceCount) {
+		side++;
+	}
 
-	VKCommandBuffer::endSingleTimeCommands(commandBuffer);
+	float scale = 1.0f / side;
+	float spacing = 2.0f * scale;
+	float origin = -0.5f * spacing * (side - 1);
+
+	for (uint32_t i = 0; i < instanceCount; i++) {
+		glm::vec3 cell(i % side, (i / side) % side, i / (side * side));
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(origin) + cell * spacing);
+		uint32_t material = i % static_cast<uint32_t>(defaultScene.materials.size());
+		defaultScene.addInstance(mesh, material, glm::scale(model, glm::vec3(scale)));
+	}
+	return defaultScene;
+}
+
+void VulkanApp::readAsset(const std::string& fileName, VKAsyncIO::DecodeFunc decode) {
+	const VKAssetArchive::Entry* entry = assetArchive.findCurrent(fileName);
+	if (entry != nullptr) {
+		assetArchive.read(assetIO, *entry, std::move(decode));
+	}
+	else {
+		assetIO.read(fileName, std::move(decode));
+	}
 }
 
-void VulkanApp::createTextureImage(const char* filename, VKImage* image) {
+void VulkanApp::loadTextureImage(const std::string& filename, VKImage* image) {
+	readAsset(filename, [this, image](const char* data, size_t size) {
+		auto texture = std::make_shared<std::vector<char>>(loadTexture(data, size));
+		assetIO.runOnMainThread([this, texture, image]() {
+			createTextureImage(*texture, image);
+		});
+	});
+}
+
+// decodes the image and builds its whole mip chain on the cpu, or takes both from the asset cache;
+// runs on an asset worker
+std::vector<char> VulkanApp::loadTexture(const char* data, size_t size) {
+	uint64_t key = VKAssetCache::hash(data, size, VKAssetCache::hash(&TextureCacheVersion, sizeof(TextureCacheVersion)));
+	std::vector<char> texture;
+	if (assetCache.load("texture", key, texture)) {
+		return texture;
+	}
+
 	int texWidth, texHeight, texChannels;
-	stbi_uc* pixels = stbi_load(filename, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-	VkDeviceSize imageSize = texWidth * texHeight * 4;
+	std::shared_ptr<stbi_uc> pixels(stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(data), static_cast<int>(size),
+		&texWidth, &texHeight, &texChannels, STBI_rgb_alpha), stbi_image_free);
+	CHECK_RESULT(pixels, "Failed to load image!");
+
+	uint32_t width = static_cast<uint32_t>(texWidth);
+	uint32_t height = static_cast<uint32_t>(texHeight);
 	uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
 
-	CHECK_RESULT(pixels, "Failed to load image!");
+	VKAssetCache::Writer writer;
+	writer.write(width);
+	writer.write(height);
+	writer.write(mipLevels);
+	size_t levelOffset = writer.data.size();
+	writer.data.insert(writer.data.end(), pixels.get(), pixels.get() + size_t(width) * height * 4);
+
+	// each level is a 2x2 box filter of the one above, the last row or column repeats on odd sizes
+	for (uint32_t level = 1; level < mipLevels; level++) {
+		uint32_t mipWidth = std::max(width / 2, 1u);
+		uint32_t mipHeight = std::max(height / 2, 1u);
+		size_t mipOffset = writer.data.size();
+		writer.data.resize(mipOffset + size_t(mipWidth) * mipHeight * 4);
+
+		const uint8_t* source = reinterpret_cast<const uint8_t*>(writer.data.data() + levelOffset);
+		uint8_t* destination = reinterpret_cast<uint8_t*>(writer.data.data() + mipOffset);
+		for (uint32_t y = 0; y < mipHeight; y++) {
+			uint32_t y0 = std::min(y * 2, height - 1);
+			uint32_t y1 = std::min(y * 2 + 1, height - 1);
+			for (uint32_t x = 0; x < mipWidth; x++) {
+				uint32_t x0 = std::min(x * 2, width - 1);
+				uint32_t x1 = std::min(x * 2 + 1, width - 1);
+				for (uint32_t c = 0; c < 4; c++) {
+					uint32_t sum = source[(size_t(y0) * width + x0) * 4 + c] + source[(size_t(y0) * width + x1) * 4 + c]
+						+ source[(size_t(y1) * width + x0) * 4 + c] + source[(size_t(y1) * width + x1) * 4 + c];
+					destination[(size_t(y) * mipWidth + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+				}
+			}
+		}
+
+		levelOffset = mipOffset;
+		width = mipWidth;
+		height = mipHeight;
+	}
+
+	assetCache.store("texture", key, writer.data);
+	return std::move(writer.data);
+}
+
+void VulkanApp::createTextureImage(const std::vector<char>& texture, VKImage* image) {
+	VKAssetCache::Reader reader(texture.data(), texture.size());
+	uint32_t texWidth = reader.read<uint32_t>();
+	uint32_t texHeight = reader.read<uint32_t>();
+	uint32_t mipLevels = reader.read<uint32_t>();
+	// every level, packed the way copyBufferToImage expects them
+	VkDeviceSize imageSize = texture.size() - 3 * sizeof(uint32_t);
+	const char* pixels = reader.take(static_cast<size_t>(imageSize));
 
 	VKBuffer stagingBuffer;
 	VKBuffer::createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer);
@@ -270,26 +380,43 @@ void VulkanApp::createTextureImage(const char* filename, VKImage* image) {
 	memcpy(data, pixels, static_cast<size_t>(imageSize));
 	vkUnmapMemory(device, stagingBuffer.bufferMemory);
 
-	stbi_image_free(pixels);
-
 	image->createImage(texWidth, texHeight, mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 	transitionImageLayout(image->image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
-	copyBufferToImage(stagingBuffer.buffer, image->image, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-	generateMipmaps(image->image, VK_FORMAT_R8G8B8A8_UNORM, texWidth, texHeight, mipLevels);
+	copyBufferToImage(stagingBuffer.buffer, image->image, texWidth, texHeight, mipLevels);
+	transitionImageLayout(image->image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels);
 
 	image->createImageView(VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
 	image->createSampler();
+
+	stagingBuffer.clearDeferred();
 }
 
-void VulkanApp::loadModel() {
+// runs on an asset worker, the meshes are merged into the shared buffers once all of them are loaded
+MeshData VulkanApp::loadMesh(const char* data, size_t size) {
+	// the vertex layout is part of the key, changing Vertex invalidates every cached mesh
+	const uint32_t meshParameters[] = { MeshCacheVersion, sizeof(Vertex) };
+	uint64_t key = VKAssetCache::hash(data, size, VKAssetCache::hash(meshParameters, sizeof(meshParameters)));
+	MeshData mesh;
+	std::vector<char> cached;
+	if (assetCache.load("mesh", key, cached)) {
+		VKAssetCache::Reader reader(cached.data(), cached.size());
+		mesh.vertices = reader.readArray<Vertex>();
+		mesh.indices = reader.readArray<uint32_t>();
+		mesh.bounds = reader.read<glm::vec4>();
+		return mesh;
+	}
+
 	tinyobj::attrib_t attrib;
 	std::vector<tinyobj::shape_t> shapes;
 	std::vector<tinyobj::material_t> materials;
 	std::string warn, err;
 
-	CHECK_RESULT(tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH.c_str()), warn + err);
+	VKMemoryStreamBuffer buffer(data, size);
+	std::istream stream(&buffer);
+	tinyobj::MaterialFileReader materialReader("");
+	CHECK_RESULT(tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &stream, &materialReader), warn + err);
 
 	std::unordered_map<Vertex, uint32_t> uniqueVertices = {};
 
@@ -311,13 +438,68 @@ void VulkanApp::loadModel() {
 			vertex.color = { 1.0f, 1.0f, 1.0f };
 
 			if (uniqueVertices.count(vertex) == 0) {
-				uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-				vertices.push_back(vertex);
+				uniqueVertices[vertex] = static_cast<uint32_t>(mesh.vertices.size());
+				mesh.vertices.push_back(vertex);
 			}
 
-			indices.push_back(uniqueVertices[vertex]);
+			mesh.indices.push_back(uniqueVertices[vertex]);
 		}
 	}
+
+	glm::vec3 minPos(std::numeric_limits<float>::max());
+	glm::vec3 maxPos(-std::numeric_limits<float>::max());
+	for (const Vertex& vertex : mesh.vertices) {
+		minPos = glm::min(minPos, vertex.pos);
+		maxPos = glm::max(maxPos, vertex.pos);
+	}
+
+	glm::vec3 center = (minPos + maxPos) * 0.5f;
+	float radius = 0.0f;
+	for (const Vertex& vertex : mesh.vertices) {
+		radius = std::max(radius, glm::length(vertex.pos - center));
+	}
+	mesh.bounds = glm::vec4(center, radius);
+
+	VKAssetCache::Writer writer;
+	writer.writeArray(mesh.vertices);
+	writer.writeArray(mesh.indices);
+	writer.write(mesh.bounds);
+	assetCache.store("mesh", key, writer.data);
+	return mesh;
+}
+
+// every mesh goes into the same vertex, position and index buffers; draws select theirs
+// with firstIndex and vertexOffset, so the whole scene is three allocations and one binding
+void VulkanApp::createMeshBuffers(const std::vector<MeshData>& meshData) {
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	for (const MeshData& mesh : meshData) {
+		vertexCount += mesh.vertices.size();
+		indexCount += mesh.indices.size();
+	}
+
+	vertices.clear();
+	indices.clear();
+	vertices.reserve(vertexCount);
+	indices.reserve(indexCount);
+	meshes.clear();
+	for (const MeshData& mesh : meshData) {
+		SceneMesh sceneMesh;
+		sceneMesh.vertexOffset = static_cast<int32_t>(vertices.size());
+		sceneMesh.firstIndex = static_cast<uint32_t>(indices.size());
+		sceneMesh.indexCount = static_cast<uint32_t>(mesh.indices.size());
+		sceneMesh.bounds = mesh.bounds;
+		meshes.push_back(sceneMesh);
+
+		vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+		indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+	}
+
+	createVertexBuffer();
+	createPositionBuffer();
+	createIndexBuffer();
+
+	std::cout << meshes.size() << " mesh(es), " << vertices.size() << " vertices, " << indices.size() << " indices" << std::endl;
 }
 
 void VulkanApp::createVertexBuffer() {
@@ -325,28 +507,130 @@ void VulkanApp::createVertexBuffer() {
 	vertexBuffer.createBuffer(bufferSize, vertices.data(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
 }
 
+void VulkanApp::createPositionBuffer() {
+	std::vector<glm::vec3> positions(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++) {
+		positions[i] = vertices[i].pos;
+	}
+
+	VkDeviceSize bufferSize = sizeof(positions[0]) * positions.size();
+	positionBuffer.createBuffer(bufferSize, positions.data(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+}
+
 void VulkanApp::createIndexBuffer() {
 	VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
 	indexBuffer.createBuffer(bufferSize, indices.data(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 }
 
+void VulkanApp::createInstances() {
+	// scene materials map one to one onto the material buffer
+	instances.resize(scene.instances.size());
+	for (size_t i = 0; i < scene.instances.size(); i++) {
+		instances[i] = {};
+		instances[i].model = scene.instances[i].transform;
+		instances[i].material = scene.instances[i].material;
+	}
+
+	// one group per shading variant in use, objects are ordered by group
+	drawGroups.clear();
+	for (const InstanceData& instance : instances) {
+		uint32_t features = materials[instance.material].features;
+		auto found = std::find_if(drawGroups.begin(), drawGroups.end(), [features](const DrawGroup& group) {
+			return group.features == features;
+		});
+		if (found == drawGroups.end()) {
+			DrawGroup group;
+			group.features = features;
+			drawGroups.push_back(group);
+		}
+	}
+
+	objects.clear();
+	for (uint32_t g = 0; g < drawGroups.size(); g++) {
+		DrawGroup& group = drawGroups[g];
+		group.firstObject = static_cast<uint32_t>(objects.size());
+		for (uint32_t i = 0; i < instances.size(); i++) {
+			if (materials[instances[i].material].features != group.features) {
+				continue;
+			}
+			const SceneMesh& mesh = meshes[scene.instances[i].mesh];
+			ObjectData object = {};
+			object.boundingSphere = mesh.bounds;
+			object.indexCount = mesh.indexCount;
+			object.firstIndex = mesh.firstIndex;
+			object.vertexOffset = mesh.vertexOffset;
+			object.instanceIndex = i;
+			object.drawGroup = g;
+			object.firstDraw = group.firstObject;
+			objects.push_back(object);
+		}
+		group.objectCount = static_cast<uint32_t>(objects.size()) - group.firstObject;
+	}
+
+	std::cout << materials.size() << " materials in " << drawGroups.size() << " shading variant(s)" << std::endl;
+}
+
+void VulkanApp::createMaterials() {
+	// each texture once, however many materials use it
+	std::vector<uint32_t> textureSlots;
+	for (const std::unique_ptr<VKImage>& texture : textures) {
+		textureSlots.push_back(textureTable.registerTexture(*texture));
+	}
+
+	// the maps a material has select its shader variant;
+	// unused texture slots point at the diffuse texture so they stay valid indices
+	materials.clear();
+	for (const VKSceneMaterial& sceneMaterial : scene.materials) {
+		MaterialData material = {};
+		material.diffuseTexture = textureSlots[sceneMaterial.diffuseTexture];
+		material.normalTexture = material.diffuseTexture;
+		material.specularTexture = material.diffuseTexture;
+		if (sceneMaterial.normalTexture >= 0) {
+			material.normalTexture = textureSlots[sceneMaterial.normalTexture];
+			material.features |= MaterialNormalMap;
+		}
+		if (sceneMaterial.specularTexture >= 0) {
+			material.specularTexture = textureSlots[sceneMaterial.specularTexture];
+			material.features |= MaterialSpecular;
+		}
+		materials.push_back(material);
+	}
+
+	std::cout << textureTable.getTextureCount() << " textures, " << VKSamplerCache::getSamplerCount() << " sampler(s)" << std::endl;
+}
+
+void VulkanApp::createMaterialBuffer() {
+	VkDeviceSize bufferSize = sizeof(materials[0]) * materials.size();
+	materialBuffer.createBuffer(bufferSize, materials.data(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+}
+
+void VulkanApp::createInstanceBuffer() {
+	VkDeviceSize bufferSize = sizeof(instances[0]) * instances.size();
+	instanceBuffer.createBuffer(bufferSize, instances.data(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+}
+
+void VulkanApp::createObjectBuffer() {
+	VkDeviceSize bufferSize = sizeof(objects[0]) * objects.size();
+	objectBuffer.createBuffer(bufferSize, objects.data(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+}
+
 void VulkanApp::createUniformBuffers() {
 	VkDeviceSize bufferSize = sizeof(UniformBufferObject);
-	uniformBuffers.resize(swapchain.images.size());
-	for (size_t i = 0; i < swapchain.images.size(); i++) {
-		VKBuffer::createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &uniformBuffers[i]);
+	for (size_t i = 0; i < frames.size(); i++) {
+		VKBuffer::createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &frames[i].uniformBuffer);
 	}
 }
 
-void VulkanApp::updateUniformBuffer(uint32_t currentImage) {
+void VulkanApp::updateUniformBuffer(FrameContext& frame) {
 	static auto startTime = std::chrono::high_resolution_clock::now();
 
 	auto currentTime = std::chrono::high_resolution_clock::now();
 	float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
 	//float time = 0;
 
+	drawConstants.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+
 	UniformBufferObject ubo = {};
-	ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
 	//ubo.view = glm::lookAt(glm::vec3(1.0f, 1.0f, 3.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 	ubo.view = glm::lookAt(glm::vec3(1.0f, 1.0f, 4.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 	//ubo.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float)swapChainExtent.height, 0.1f, 10.0f);
@@ -354,158 +638,406 @@ void VulkanApp::updateUniformBuffer(uint32_t currentImage) {
 	ubo.proj[1][1] *= -1;
 
 	void* data;
-	vkMapMemory(device, uniformBuffers[currentImage].bufferMemory, 0, sizeof(ubo), 0, &data);
+	vkMapMemory(device, frame.uniformBuffer.bufferMemory, 0, sizeof(ubo), 0, &data);
 	memcpy(data, &ubo, sizeof(ubo));
-	vkUnmapMemory(device, uniformBuffers[currentImage].bufferMemory);
+	vkUnmapMemory(device, frame.uniformBuffer.bufferMemory);
 }
 
-void VulkanApp::createDescriptorPool() {
-	std::array<VkDescriptorPoolSize, 5> poolSizes = {};
-	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[0].descriptorCount = static_cast<uint32_t>(swapchain.images.size());
-	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes[1].descriptorCount = static_cast<uint32_t>(swapchain.images.size());
-	poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes[2].descriptorCount = static_cast<uint32_t>(swapchain.images.size());
-	poolSizes[3].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes[3].descriptorCount = static_cast<uint32_t>(swapchain.images.size());
-	poolSizes[4].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes[4].descriptorCount = static_cast<uint32_t>(swapchain.images.size());
-
-	VkDescriptorPoolCreateInfo poolInfo = {};
-	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.poolSizeCount = (uint32_t)poolSizes.size();
-	poolInfo.pPoolSizes = poolSizes.data();
-	poolInfo.maxSets = static_cast<uint32_t>(swapchain.images.size());
+void VulkanApp::createDescriptorSets() {
+	for (FrameContext& frame : frames) {
+		frame.descriptorSet = descriptorAllocator.getSet(descriptorSetLayout, {
+			VKDescriptorBinding::buffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frame.uniformBuffer.buffer, sizeof(UniformBufferObject)),
+			VKDescriptorBinding::buffer(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, instanceBuffer.buffer),
+			VKDescriptorBinding::buffer(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, materialBuffer.buffer)
+		});
+	}
+}
 
-	VULKAN_CHECK_RESULT(vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool), "Failed to create descriptor pool!");
+void VulkanApp::createCullDescriptorSets() {
+	for (FrameContext& frame : frames) {
+		frame.cullDescriptorSet = descriptorAllocator.getSet(cullDescriptorSetLayout, {
+			VKDescriptorBinding::buffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frame.uniformBuffer.buffer),
+			VKDescriptorBinding::buffer(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, instanceBuffer.buffer),
+			VKDescriptorBinding::buffer(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, objectBuffer.buffer),
+			VKDescriptorBinding::buffer(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.drawCommandBuffer.buffer),
+			VKDescriptorBinding::buffer(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.drawCountBuffer.buffer)
+		});
+	}
 }
 
-void VulkanApp::createDescriptorSets() {
-	std::vector<VkDescriptorSetLayout> layouts(swapchain.images.size(), descriptorSetLayout);
-	VkDescriptorSetAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = descriptorPool;
-	allocInfo.descriptorSetCount = static_cast<uint32_t>(swapchain.images.size());
-	allocInfo.pSetLayouts = layouts.data();
-
-	descriptorSets.resize(swapchain.images.size());
-	VULKAN_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()), "Failed to allocate descriptor sets!");
-
-	for (size_t i = 0; i < swapchain.images.size(); i++) {
-		VkDescriptorBufferInfo bufferInfo = {};
-		bufferInfo.buffer = uniformBuffers[i].buffer;
-		bufferInfo.offset = 0;
-		bufferInfo.range = sizeof(UniformBufferObject);
-
-		VkDescriptorImageInfo textureInfo = {};
-		textureInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		textureInfo.imageView = textureImage.imageView;
-		textureInfo.sampler = textureImage.sampler;
-
-		VkDescriptorImageInfo normalInfo = {};
-		normalInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		normalInfo.imageView = normalImage.imageView;
-		normalInfo.sampler = normalImage.sampler;
-
-		VkDescriptorImageInfo specularInfo = {};
-		specularInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		specularInfo.imageView = specularImage.imageView;
-		specularInfo.sampler = specularImage.sampler;
-		
-		std::array<VkWriteDescriptorSet, 4> descriptorWrites = {};
-
-		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[0].dstSet = descriptorSets[i];
-		descriptorWrites[0].dstBinding = 0;
-		descriptorWrites[0].dstArrayElement = 0;
-		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorWrites[0].descriptorCount = 1;
-		descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[1].dstSet = descriptorSets[i];
-		descriptorWrites[1].dstBinding = 1;
-		descriptorWrites[1].dstArrayElement = 0;
-		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		descriptorWrites[1].descriptorCount = 1;
-		descriptorWrites[1].pImageInfo = &textureInfo;
-
-		descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[2].dstSet = descriptorSets[i];
-		descriptorWrites[2].dstBinding = 2;
-		descriptorWrites[2].dstArrayElement = 0;
-		descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		descriptorWrites[2].descriptorCount = 1;
-		descriptorWrites[2].pImageInfo = &normalInfo;
-
-		descriptorWrites[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[3].dstSet = descriptorSets[i];
-		descriptorWrites[3].dstBinding = 3;
-		descriptorWrites[3].dstArrayElement = 0;
-		descriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		descriptorWrites[3].descriptorCount = 1;
-		descriptorWrites[3].pImageInfo = &specularInfo;
-
-		vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
-	}
-}
-
-void VulkanApp::createSyncObjects() {
-	imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-	renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-	inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+void VulkanApp::createFrameContexts() {
+	frames.resize(framePacer.framesInFlight);
+
+	createUniformBuffers();
+	for (FrameContext& frame : frames) {
+		VKBuffer::createBuffer(sizeof(VkDrawIndexedIndirectCommand) * objects.size(),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &frame.drawCommandBuffer);
+		// one count per draw group
+		VKBuffer::createBuffer(sizeof(uint32_t) * drawGroups.size(),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &frame.drawCountBuffer);
+	}
+
+	createDescriptorSets();
+	createCullDescriptorSets();
+	descriptorAllocator.flush();
 
 	VkSemaphoreCreateInfo semaphoreInfo = {};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	VkFenceCreateInfo fenceInfo = {};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+	for (FrameContext& frame : frames) {
+		frame.commandBuffer = VKCommandBuffer::allocateCommandBuffer();
+		frame.timelineValue = 0;
 
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		VULKAN_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]), "Failed to create semaphore!");
-		VULKAN_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]), "Failed to create semaphore!");
-		VULKAN_CHECK_RESULT(vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]), "Failed to create fence!");
+		VULKAN_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &frame.imageAvailableSemaphore), "Failed to create semaphore!");
+		VULKAN_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &frame.renderFinishedSemaphore), "Failed to create semaphore!");
 	}
+
+	if (timestampsSupported) {
+		VkQueryPoolCreateInfo queryPoolInfo = {};
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount = 2;
+
+		for (FrameContext& frame : frames) {
+			VULKAN_CHECK_RESULT(vkCreateQueryPool(device, &queryPoolInfo, nullptr, &frame.timestampQueryPool), "Failed to create query pool!");
+			frame.timestampsWritten = false;
+		}
+	}
+
+	if (pipelineStatisticsSupported) {
+		VkQueryPoolCreateInfo queryPoolInfo = {};
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		queryPoolInfo.queryCount = 1;
+		queryPoolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+		for (FrameContext& frame : frames) {
+			VULKAN_CHECK_RESULT(vkCreateQueryPool(device, &queryPoolInfo, nullptr, &frame.statisticsQueryPool), "Failed to create query pool!");
+			frame.statisticsWritten = false;
+		}
+	}
+}
+
+void VulkanApp::destroyFrameContexts() {
+	for (FrameContext& frame : frames) {
+		VKCommandBuffer::freeCommandBuffer(frame.commandBuffer);
+		frame.uniformBuffer.clear();
+		frame.drawCommandBuffer.clear();
+		frame.drawCountBuffer.clear();
+
+		vkDestroySemaphore(device, frame.renderFinishedSemaphore, nullptr);
+		vkDestroySemaphore(device, frame.imageAvailableSemaphore, nullptr);
+		vkDestroyQueryPool(device, frame.timestampQueryPool, nullptr);
+		vkDestroyQueryPool(device, frame.statisticsQueryPool, nullptr);
+	}
+	frames.clear();
+
+	// every set references the frame buffers destroyed above
+	descriptorAllocator.clear();
+}
+
+void VulkanApp::recordCulling(FrameContext& frame, VkCommandBuffer commandBuffer) {
+	CullPushConstants pushConstants = {};
+	pushConstants.model = drawConstants.model;
+	pushConstants.objectCount = static_cast<uint32_t>(objects.size());
+	pushConstants.compact = drawIndirectCountSupported ? 1 : 0;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &frame.cullDescriptorSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+	vkCmdDispatch(commandBuffer, (pushConstants.objectCount + 63) / 64, 1, 1);
+}
+
+void VulkanApp::recordCommandBuffer(FrameContext& frame, uint32_t imageIndex) {
+	VkCommandBuffer commandBuffer = frame.commandBuffer;
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = nullptr;
+
+	VULKAN_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo), "Failed to begin recording command buffer!");
+
+	if (frame.timestampQueryPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(commandBuffer, frame.timestampQueryPool, 0, 2);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.timestampQueryPool, 0);
+	}
+	if (frame.statisticsQueryPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(commandBuffer, frame.statisticsQueryPool, 0, 1);
+	}
+
+	VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencilComponent(depthFormat) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+
+	// color, depth and the scene image are shared by all frames in flight, so wait for the previous frame's uses;
+	// the swapchain image waits for the acquire semaphore, which is waited on at transfer
+	renderGraph.reset();
+	VKRenderGraph::Resource drawCount = renderGraph.importBuffer(frame.drawCountBuffer.buffer);
+	VKRenderGraph::Resource drawCommands = renderGraph.importBuffer(frame.drawCommandBuffer.buffer);
+	VKRenderGraph::Resource depth = renderGraph.importImage(depthImage.image, depthAspect, 1,
+		VK_IMAGE_LAYOUT_UNDEFINED, VKResourceUsage::DepthAttachment);
+	VKRenderGraph::Resource scene = renderGraph.importImage(sceneColor.image, VK_IMAGE_ASPECT_COLOR_BIT, 1,
+		VK_IMAGE_LAYOUT_UNDEFINED, VKResourceUsage::Transfer);
+	VKRenderGraph::Resource target = renderGraph.importImage(swapchain.images[imageIndex], VK_IMAGE_ASPECT_COLOR_BIT, 1,
+		VK_IMAGE_LAYOUT_UNDEFINED, VKResourceUsage::Transfer, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+	renderGraph.addPass("clear draw count", [&](VkCommandBuffer commandBuffer) {
+		vkCmdFillBuffer(commandBuffer, frame.drawCountBuffer.buffer, 0, sizeof(uint32_t) * drawGroups.size(), 0);
+	})
+		.write(drawCount, VKResourceUsage::Transfer);
+
+	renderGraph.addPass("cull", [&](VkCommandBuffer commandBuffer) {
+		recordCulling(frame, commandBuffer);
+	})
+		.read(drawCount, VKResourceUsage::ComputeShader)
+		.write(drawCount, VKResourceUsage::ComputeShader)
+		.write(drawCommands, VKResourceUsage::ComputeShader);
+
+	VKRenderGraph::Pass& mainPass = renderGraph.addPass("main", [&](VkCommandBuffer commandBuffer) {
+		recordMainPass(frame, commandBuffer);
+	})
+		.read(drawCount, VKResourceUsage::IndirectCommand)
+		.read(drawCommands, VKResourceUsage::IndirectCommand)
+		.write(depth, VKResourceUsage::DepthAttachment)
+		.write(scene, VKResourceUsage::ColorAttachment);
+
+	if (quality.resolves()) {
+		VKRenderGraph::Resource color = renderGraph.importImage(colorImage.image, VK_IMAGE_ASPECT_COLOR_BIT, 1,
+			VK_IMAGE_LAYOUT_UNDEFINED, VKResourceUsage::ColorAttachment);
+		mainPass.write(color, VKResourceUsage::ColorAttachment);
+	}
+
+	renderGraph.addPass("upscale", [&](VkCommandBuffer commandBuffer) {
+		recordUpscale(imageIndex, commandBuffer);
+	})
+		.read(scene, VKResourceUsage::Transfer)
+		.write(target, VKResourceUsage::Transfer);
+
+	renderGraph.compile();
+	renderGraph.execute(commandBuffer);
+
+	if (frame.timestampQueryPool != VK_NULL_HANDLE) {
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.timestampQueryPool, 1);
+		frame.timestampsWritten = true;
+	}
+
+	VULKAN_CHECK_RESULT(vkEndCommandBuffer(commandBuffer), "Failed to record command buffer!");
+}
+
+void VulkanApp::recordMainPass(FrameContext& frame, VkCommandBuffer commandBuffer) {
+	VkRenderPassBeginInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = renderPass;
+	renderPassInfo.framebuffer = sceneFramebuffer;
+
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = renderExtent;
+
+	// color, depth and, when multisampled, the resolve target
+	std::vector<VkClearValue> clearValues(quality.resolves() ? 3 : 2);
+	clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
+	clearValues[1].depthStencil = { 1.0f, 0 };
+	if (quality.resolves()) {
+		clearValues[2].color = { 0.0f, 0.0f, 0.0f, 1.0f };
+	}
+
+	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+	renderPassInfo.pClearValues = clearValues.data();
+
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	VkViewport viewport = {};
+	viewport.x = 0.f;
+	viewport.y = 0.f;
+	viewport.width = (float)renderExtent.width;
+	viewport.height = (float)renderExtent.height;
+	viewport.minDepth = 0.f;
+	viewport.maxDepth = 1.f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor = {};
+	scissor.extent = renderExtent;
+	scissor.offset = { 0, 0 };
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	vkCmdBindIndexBuffer(commandBuffer, indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+	VkDescriptorSet descriptorSets[] = { frame.descriptorSet, textureTable.set };
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 2, descriptorSets, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, pipelineLayout, drawPushConstantStages, 0, sizeof(drawConstants), &drawConstants);
+
+	// each group's draws sit in its own range of the command buffer, with its own count
+	auto drawGroup = [&](uint32_t index) {
+		const DrawGroup& group = drawGroups[index];
+		VkDeviceSize commandOffset = group.firstObject * sizeof(VkDrawIndexedIndirectCommand);
+		if (drawIndirectCountSupported) {
+			cmdDrawIndexedIndirectCount(commandBuffer, frame.drawCommandBuffer.buffer, commandOffset, frame.drawCountBuffer.buffer,
+				index * sizeof(uint32_t), group.objectCount, sizeof(VkDrawIndexedIndirectCommand));
+		}
+		else {
+			vkCmdDrawIndexedIndirect(commandBuffer, frame.drawCommandBuffer.buffer, commandOffset, group.objectCount, sizeof(VkDrawIndexedIndirectCommand));
+		}
+	};
+
+	for (DrawGroup& group : drawGroups) {
+		if (pipelineManager.getPipeline(group.shadingPipelineDesc) != VK_NULL_HANDLE) {
+			group.readyPipelineDesc = group.shadingPipelineDesc;
+		}
+	}
+
+	VkDeviceSize offsets[] = { 0 };
+
+	// the pre-pass needs all of its pipelines, until they are compiled the frame is drawn without it
+	depthPrepassActive = false;
+	if (depthPrepass) {
+		VkPipeline depthPipeline = pipelineManager.getPipeline(depthPipelineDesc);
+		depthPrepassActive = depthPipeline != VK_NULL_HANDLE;
+		for (const DrawGroup& group : drawGroups) {
+			depthPrepassActive = pipelineManager.getPipeline(group.prepassShadingPipelineDesc) != VK_NULL_HANDLE && depthPrepassActive;
+		}
+
+		// same subpass, so the shading draws see the pre-pass depth through rasterization order
+		if (depthPrepassActive) {
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPipeline);
+			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &positionBuffer.buffer, offsets);
+			for (uint32_t i = 0; i < drawGroups.size(); i++) {
+				drawGroup(i);
+			}
+		}
+	}
+
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer.buffer, offsets);
+
+	if (frame.statisticsQueryPool != VK_NULL_HANDLE) {
+		vkCmdBeginQuery(commandBuffer, frame.statisticsQueryPool, 0, 0);
+	}
+	for (uint32_t i = 0; i < drawGroups.size(); i++) {
+		const VKPipelineDesc& shadingDesc = depthPrepassActive ? drawGroups[i].prepassShadingPipelineDesc : drawGroups[i].readyPipelineDesc;
+		VkPipeline shadingPipeline = pipelineManager.getPipeline(shadingDesc);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadingPipeline);
+		drawGroup(i);
+	}
+	if (frame.statisticsQueryPool != VK_NULL_HANDLE) {
+		vkCmdEndQuery(commandBuffer, frame.statisticsQueryPool, 0);
+		frame.statisticsWritten = true;
+	}
+
+	vkCmdEndRenderPass(commandBuffer);
+}
+
+void VulkanApp::recordUpscale(uint32_t imageIndex, VkCommandBuffer commandBuffer) {
+	if (!upscaleSupported) {
+		// renderExtent is the swapchain extent then
+		VkImageCopy copy = {};
+		copy.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		copy.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		copy.extent = { swapchain.extent.width, swapchain.extent.height, 1 };
+		vkCmdCopyImage(commandBuffer, sceneColor.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			swapchain.images[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+		return;
+	}
+
+	VkImageBlit blit = {};
+	blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	blit.srcOffsets[0] = { 0, 0, 0 };
+	blit.srcOffsets[1] = { (int32_t)renderExtent.width, (int32_t)renderExtent.height, 1 };
+	blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	blit.dstOffsets[0] = { 0, 0, 0 };
+	blit.dstOffsets[1] = { (int32_t)swapchain.extent.width, (int32_t)swapchain.extent.height, 1 };
+
+	// at full resolution this is a plain copy
+	VkFilter filter = renderExtent.width == swapchain.extent.width && renderExtent.height == swapchain.extent.height ? VK_FILTER_NEAREST : upscaleFilter;
+	vkCmdBlitImage(commandBuffer, sceneColor.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		swapchain.images[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, filter);
+}
+
+void VulkanApp::readFrameQueries(FrameContext& frame) {
+	// the frame's timeline value has been reached, so the results are available without waiting
+	if (frame.timestampsWritten) {
+		uint64_t timestamps[2];
+		VkResult result = vkGetQueryPoolResults(device, frame.timestampQueryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT);
+		frame.timestampsWritten = false;
+		if (result == VK_SUCCESS && timestamps[1] >= timestamps[0]) {
+			resolutionController.update((timestamps[1] - timestamps[0]) * timestampPeriod / 1000000.f);
+		}
+	}
+
+	if (frame.statisticsWritten) {
+		uint64_t fragmentInvocations;
+		VkResult result = vkGetQueryPoolResults(device, frame.statisticsQueryPool, 0, 1, sizeof(fragmentInvocations), &fragmentInvocations,
+			sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+		frame.statisticsWritten = false;
+		if (result == VK_SUCCESS) {
+			// with sample shading each covered pixel runs the shader at least once per shaded sample
+			float shadedSamples = 1.f;
+			if (quality.sampleShading) {
+				shadedSamples = std::max(1.f, std::ceil(quality.minSampleShading * quality.getSamples()));
+			}
+			fragmentsPerPixel = fragmentInvocations / (float(renderExtent.width * renderExtent.height) * shadedSamples);
+		}
+	}
+}
+
+void VulkanApp::waitForPreviousFrame() {
+	VKTimeline::wait(VKTimeline::getPendingValue());
 }
 
 void VulkanApp::drawFrame() {
-	vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+	FrameContext& frame = frames[currentFrame];
+
+	VKTimeline::wait(frame.timelineValue);
+	VKTimeline::collectGarbage();
+	readFrameQueries(frame);
 	
 	uint32_t imageIndex;
 
-	VkResult result = vkAcquireNextImageKHR(device, swapchain.swapchain, std::numeric_limits<uint64_t>::max(), imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+	VkResult result = vkAcquireNextImageKHR(device, swapchain.swapchain, std::numeric_limits<uint64_t>::max(), frame.imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
 		recreateSwapChain();
 		return;
 	}
 	else CHECK_RESULT(result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR, "Failed to acquire swap chain image!");
+
+	// the image may have been acquired out of order and still be rendered by another frame slot
+	VKTimeline::wait(imagesInFlight[imageIndex]);
 	
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+	// the swapchain image is first touched by the upscale blit
+	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_TRANSFER_BIT };
 
-	updateUniformBuffer(imageIndex);
+	renderExtent = upscaleSupported ? resolutionController.getRenderExtent(swapchain.extent) : swapchain.extent;
+
+	updateUniformBuffer(frame);
+	recordCommandBuffer(frame, imageIndex);
+
+	frame.timelineValue = VKTimeline::nextSignalValue();
+	imagesInFlight[imageIndex] = frame.timelineValue;
+
+	VkSemaphore signalSemaphores[] = { frame.renderFinishedSemaphore, VKTimeline::semaphore };
+	uint64_t signalValues[] = { 0, frame.timelineValue };
+
+	VkTimelineSemaphoreSubmitInfoKHR timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+	timelineInfo.signalSemaphoreValueCount = 2;
+	timelineInfo.pSignalSemaphoreValues = signalValues;
 
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
 	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = &imageAvailableSemaphores[currentFrame];
+	submitInfo.pWaitSemaphores = &frame.imageAvailableSemaphore;
 	submitInfo.pWaitDstStageMask = waitStages;
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = VKCommandBuffer::getCommandBuffer(imageIndex);
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = &renderFinishedSemaphores[currentFrame];
-
-	vkResetFences(device, 1, &inFlightFences[currentFrame]);
+	submitInfo.pCommandBuffers = &frame.commandBuffer;
+	submitInfo.signalSemaphoreCount = 2;
+	submitInfo.pSignalSemaphores = signalSemaphores;
 
-	VULKAN_CHECK_RESULT(vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]), "Failed to submit draw command buffer!");
+	VULKAN_CHECK_RESULT(vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE), "Failed to submit draw command buffer!");
 
 	VkPresentInfoKHR presentInfo = {};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
 	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = &renderFinishedSemaphores[currentFrame];
+	presentInfo.pWaitSemaphores = &frame.renderFinishedSemaphore;
 	presentInfo.swapchainCount = 1;
 	presentInfo.pSwapchains = &swapchain.swapchain;
 	presentInfo.pImageIndices = &imageIndex;
@@ -518,5 +1050,7 @@ void VulkanApp::drawFrame() {
 	}
 	else CHECK_RESULT(result == VK_SUCCESS, "Failed to present swap chain image!");
 
-	currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	framePacer.markPresented();
+
+	currentFrame = (currentFrame + 1) % framePacer.framesInFlight;
 }
\ No newline at end of file
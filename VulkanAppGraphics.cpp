@@ -1,299 +1,189 @@
 #include "VulkanApp.h"
-#include <fstream>
+#include "VKRenderPassBuilder.h"
 
-std::vector<char> readFile(const std::string& filename) {
-	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+#include <fstream>
 
-	CHECK_RESULT(file.is_open(), "failed to open file!");
+VKAssetData VulkanApp::openShader(const std::string& fileName) {
+	// a shader saved since the archive was built, hot reloaded or not, is newer than it
+	const VKAssetArchive::Entry* entry = assetArchive.findCurrent(fileName);
+	if (entry != nullptr) {
+		return assetArchive.load(*entry);
+	}
 
-	size_t fileSize = (size_t)file.tellg();
-	std::vector<char> buffer(fileSize);
+	// copied rather than mapped: shaders/ is watched and editors rewrite files in place, and touching
+	// a mapping of a file truncated under it faults
+	std::ifstream file(fileName, std::ios::ate | std::ios::binary);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open " + fileName + "!");
+	}
 
+	VKAssetData shader;
+	shader.size = static_cast<size_t>(file.tellg());
+	shader.storage.resize(shader.getPaddedSize());
 	file.seekg(0);
-	file.read(buffer.data(), fileSize);
-
-	file.close();
-
-	return buffer;
+	if (!file.read(shader.storage.data(), shader.size)) {
+		throw std::runtime_error("Failed to read " + fileName + "!");
+	}
+	shader.data = shader.storage.data();
+	return shader;
 }
 
 VkShaderModule VulkanApp::createShaderModule(const std::string fileName) {
-	auto shaderCode = readFile(fileName);
-	while (shaderCode.size() % 4 != 0) {
-		shaderCode.push_back(' ');
-	}
+	VKAssetData shaderCode = openShader(fileName);
 
+	// copies and archive entries are aligned and zero filled past the end, so the code is used in place
 	VkShaderModuleCreateInfo info = {};
 	info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	info.codeSize = shaderCode.size();
-	info.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+	info.codeSize = shaderCode.getPaddedSize();
+	info.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data);
 
 	VkShaderModule shader;
 	VULKAN_CHECK_RESULT(vkCreateShaderModule(device, &info, nullptr, &shader), "Failed to shader module!");
 	return shader;
 }
 
-void VulkanApp::createDescriptorSetLayout() {
-	VkDescriptorSetLayoutBinding uboLayoutBinding = {};
-	uboLayoutBinding.binding = 0;
-	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	uboLayoutBinding.descriptorCount = 1;
-	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-	uboLayoutBinding.pImmutableSamplers = nullptr;
-
-	VkDescriptorSetLayoutBinding samplerLayoutBinding = {};
-	samplerLayoutBinding.binding = 1;
-	samplerLayoutBinding.descriptorCount = 1;
-	samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	samplerLayoutBinding.pImmutableSamplers = nullptr;
-	samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-	VkDescriptorSetLayoutBinding normalSamplerLayoutBinding = {};
-	normalSamplerLayoutBinding.binding = 2;
-	normalSamplerLayoutBinding.descriptorCount = 1;
-	normalSamplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	normalSamplerLayoutBinding.pImmutableSamplers = nullptr;
-	normalSamplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-	VkDescriptorSetLayoutBinding specularSamplerLayoutBinding = {};
-	specularSamplerLayoutBinding.binding = 3;
-	specularSamplerLayoutBinding.descriptorCount = 1;
-	specularSamplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	specularSamplerLayoutBinding.pImmutableSamplers = nullptr;
-	specularSamplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-	std::array<VkDescriptorSetLayoutBinding, 4> bindings = { uboLayoutBinding, samplerLayoutBinding, normalSamplerLayoutBinding, specularSamplerLayoutBinding };
-
-	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
-	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-	layoutInfo.pBindings = bindings.data();
-
-	VULKAN_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout), "Failed to create descriptor set layout!");
+const VKShaderLayout& VulkanApp::reflectShader(const std::string fileName, VkShaderStageFlagBits stage) {
+	VKAssetData shaderCode = openShader(fileName);
+	return VKShaderReflection::reflect(shaderCode.data, shaderCode.size, stage);
+}
+
+VKReflectedPipelineLayout VulkanApp::reflectPipelineLayout(bool create) {
+	// the depth shader is included so the pre-pass can use the same layout and keep the bound sets
+	return VKShaderReflection::getPipelineLayout({
+		&reflectShader("shaders/vertex.spirv", VK_SHADER_STAGE_VERTEX_BIT),
+		&reflectShader("shaders/fragment.spirv", VK_SHADER_STAGE_FRAGMENT_BIT),
+		&reflectShader("shaders/depth.spirv", VK_SHADER_STAGE_VERTEX_BIT)
+	}, { { 1, textureTable.layout } }, create);
+}
+
+VKReflectedPipelineLayout VulkanApp::reflectCullPipelineLayout(bool create) {
+	return VKShaderReflection::getPipelineLayout({
+		&reflectShader("shaders/cull.spirv", VK_SHADER_STAGE_COMPUTE_BIT)
+	}, {}, create);
 }
 
 void VulkanApp::createPipelineLayout() {
-	VkPipelineLayoutCreateInfo info = {};
-	info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	info.setLayoutCount = 1;
-	info.pSetLayouts = &descriptorSetLayout;
-	info.pushConstantRangeCount = 0;
-	info.pPushConstantRanges = nullptr;
-
-	VULKAN_CHECK_RESULT(vkCreatePipelineLayout(device, &info, nullptr, &pipelineLayout), "Failed to create pipeline layout!");
+	VKReflectedPipelineLayout layout = reflectPipelineLayout();
+
+	CHECK_RESULT((layout.pushConstants.size == sizeof(DrawPushConstants)), "DrawPushConstants doesn't match the shaders!");
+
+	pipelineLayout = layout.layout;
+	descriptorSetLayout = layout.setLayouts[0];
+	drawPushConstantStages = layout.pushConstants.stageFlags;
 }
 
 void VulkanApp::createRenderPass() {
-	VkAttachmentDescription colorAttachment = {};
-	colorAttachment.format = swapchain.imageFormat;
-	colorAttachment.samples = VKImage::msaaSamples;
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentReference colorAttachmentRef = {};
-	colorAttachmentRef.attachment = 0;
-	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentDescription depthAttachment = {};
-	depthAttachment.format = findDepthFormat();
-	depthAttachment.samples = VKImage::msaaSamples;
-	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentReference depthAttachmentRef = {};
-	depthAttachmentRef.attachment = 1;
-	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentDescription colorAttachmentResolve = {};
-	colorAttachmentResolve.format = swapchain.imageFormat;
-	colorAttachmentResolve.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAttachmentResolve.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachmentResolve.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-	VkAttachmentReference colorAttachmentResolveRef = {};
-	colorAttachmentResolveRef.attachment = 2;
-	colorAttachmentResolveRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkSubpassDescription subpassInfo = {};
-	subpassInfo.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpassInfo.colorAttachmentCount = 1;
-	subpassInfo.pColorAttachments = &colorAttachmentRef;
-	subpassInfo.pDepthStencilAttachment = &depthAttachmentRef;
-	subpassInfo.pResolveAttachments = &colorAttachmentResolveRef;
-
-	VkSubpassDependency dependency = {};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-	std::array<VkAttachmentDescription, 3> attachments = { colorAttachment, depthAttachment, colorAttachmentResolve };
-
-	VkRenderPassCreateInfo info = {};
-	info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	info.attachmentCount = static_cast<uint32_t>(attachments.size());
-	info.pAttachments = attachments.data();
-	info.subpassCount = 1;
-	info.pSubpasses = &subpassInfo;
-	info.dependencyCount = 1;
-	info.pDependencies = &dependency;
-	
-	VULKAN_CHECK_RESULT(vkCreateRenderPass(device, &info, nullptr, &renderPass), "Failed to create render pass!");
+	VKRenderPassBuilder builder;
+	if (quality.resolves()) {
+		// the multisampled color is only needed until it is resolved into the scene image
+		uint32_t color = builder.addColorAttachment(swapchain.imageFormat, VKImage::msaaSamples, AttachmentInput::Cleared, AttachmentConsumer::Resolved);
+		builder.addDepthAttachment(findDepthFormat(), VKImage::msaaSamples, AttachmentInput::Cleared, AttachmentConsumer::Discarded);
+		builder.addResolveAttachment(color, swapchain.imageFormat, AttachmentConsumer::SampledLater);
+	}
+	else {
+		builder.addColorAttachment(swapchain.imageFormat, VK_SAMPLE_COUNT_1_BIT, AttachmentInput::Cleared, AttachmentConsumer::SampledLater);
+		builder.addDepthAttachment(findDepthFormat(), VK_SAMPLE_COUNT_1_BIT, AttachmentInput::Cleared, AttachmentConsumer::Discarded);
+	}
+
+	renderPass = builder.build(device);
+	attachmentBandwidth = builder.getBandwidth(swapchain.extent);
 }
 
 void VulkanApp::createGraphicsPipeline() {
+	depthPipelineDesc = getDepthPipelineDesc();
+	createShadingPipelineDescs();
+
+	// queue every variant first so the workers compile them in parallel, then wait for the ones drawing needs
+	for (DrawGroup& group : drawGroups) {
+		pipelineManager.getPipeline(group.shadingPipelineDesc);
+	}
+	for (DrawGroup& group : drawGroups) {
+		pipelineManager.getPipelineNow(group.shadingPipelineDesc);
+		group.readyPipelineDesc = group.shadingPipelineDesc;
+	}
+
+	if (depthPrepass) {
+		// start compiling the pre-pass pipelines now so they are likely ready by the first frame
+		pipelineManager.getPipeline(depthPipelineDesc);
+		for (DrawGroup& group : drawGroups) {
+			pipelineManager.getPipeline(group.prepassShadingPipelineDesc);
+		}
+	}
+}
+
+void VulkanApp::createShadingPipelineDescs() {
+	for (DrawGroup& group : drawGroups) {
+		group.shadingPipelineDesc = getShadingPipelineDesc(false, group.features);
+		group.prepassShadingPipelineDesc = getShadingPipelineDesc(true, group.features);
+	}
+}
+
+VKPipelineDesc VulkanApp::getShadingPipelineDesc(bool afterDepthPrepass, uint32_t features) {
+	VKPipelineDesc desc;
+	desc.vertexShader = "shaders/vertex.spirv";
+	desc.fragmentShader = "shaders/fragment.spirv";
+
+	reflectShader(desc.vertexShader, VK_SHADER_STAGE_VERTEX_BIT).getVertexInput(0, &desc.vertexBindings, &desc.vertexAttributes);
+	CHECK_RESULT((desc.vertexBindings[0].stride == sizeof(Vertex)), "Vertex doesn't match the vertex shader inputs!");
+
+	desc.layout = pipelineLayout;
+	desc.renderPass = renderPass;
+	desc.samples = VKImage::msaaSamples;
+	desc.sampleShading = quality.sampleShading;
+	desc.minSampleShading = quality.minSampleShading;
+
+	// after a pre-pass the depth buffer already holds the nearest surface, only fragments on it get shaded
+	desc.depthWrite = !afterDepthPrepass;
+	desc.depthCompare = afterDepthPrepass ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS;
+
+	// constant ids of fragment.spirv; work a material doesn't need is compiled out of its variant
+	desc.specializationConstants = {
+		{ 0, (features & MaterialNormalMap) != 0 ? 1u : 0u },
+		{ 1, (features & MaterialSpecular) != 0 ? 1u : 0u },
+		{ 2, lightCount }
+	};
+	return desc;
+}
+
+VKPipelineDesc VulkanApp::getDepthPipelineDesc() {
+	VKPipelineDesc desc;
+	desc.vertexShader = "shaders/depth.spirv";
+	// position only, read from positionBuffer
+	reflectShader(desc.vertexShader, VK_SHADER_STAGE_VERTEX_BIT).getVertexInput(0, &desc.vertexBindings, &desc.vertexAttributes);
+	CHECK_RESULT((desc.vertexBindings[0].stride == sizeof(glm::vec3)), "The depth shader must only read positions!");
+
+	// must match the shading pipeline so both rasterize the same samples
+	desc.layout = pipelineLayout;
+	desc.renderPass = renderPass;
+	desc.samples = VKImage::msaaSamples;
+
+	// the subpass has a color attachment, leave it untouched
+	desc.colorWriteMask = 0;
+	return desc;
+}
+
+void VulkanApp::createCullPipeline() {
+	VKReflectedPipelineLayout layout = reflectCullPipelineLayout();
+
+	CHECK_RESULT((layout.pushConstants.size == sizeof(CullPushConstants)), "CullPushConstants doesn't match the cull shader!");
+
+	cullPipelineLayout = layout.layout;
+	cullDescriptorSetLayout = layout.setLayouts[0];
+
+	VkShaderModule cullShader = createShaderModule("shaders/cull.spirv");
+
+	VkComputePipelineCreateInfo info = {};
+	info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	info.stage.module = cullShader;
+	info.stage.pName = "main";
+	info.layout = cullPipelineLayout;
 
-	VkShaderModule vertexShader = createShaderModule("shaders/vertex.spirv");
-	VkShaderModule fragmentShader = createShaderModule("shaders/fragment.spirv");
-
-
-	VkPipelineShaderStageCreateInfo vertexShaderInfo = {};
-	vertexShaderInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vertexShaderInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vertexShaderInfo.module = vertexShader;
-	vertexShaderInfo.pName = "main";
-
-	VkPipelineShaderStageCreateInfo fragmentShaderInfo = {};
-	fragmentShaderInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	fragmentShaderInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	fragmentShaderInfo.module = fragmentShader;
-	fragmentShaderInfo.pName = "main";
-
-	VkPipelineShaderStageCreateInfo shaders[] = { vertexShaderInfo , fragmentShaderInfo };
-
-	auto bindingDescription = Vertex::getBindingDescription();
-	auto attributeDescriptions = Vertex::getAttributeDescriptions();
-
-	VkPipelineVertexInputStateCreateInfo vertexInputState = {};
-	vertexInputState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputState.vertexBindingDescriptionCount = 1;
-	vertexInputState.vertexAttributeDescriptionCount = (uint32_t)attributeDescriptions.size();
-	vertexInputState.pVertexBindingDescriptions = &bindingDescription;
-	vertexInputState.pVertexAttributeDescriptions = attributeDescriptions.data();
-
-	VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = {};
-	inputAssemblyState.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssemblyState.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	inputAssemblyState.primitiveRestartEnable = VK_FALSE;
-
-	VkViewport viewport = {};
-	viewport.x = 0.f;
-	viewport.y = 0.f;
-	viewport.width = (float)swapchain.extent.width;
-	viewport.height = (float)swapchain.extent.height;
-	viewport.minDepth = 0.f;
-	viewport.maxDepth = 1.f;
-
-	VkRect2D scissor = {};
-	scissor.extent = swapchain.extent;
-	scissor.offset = { 0, 0 };
-
-	VkPipelineViewportStateCreateInfo viewportState = {};
-	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewportState.viewportCount = 1;
-	viewportState.pViewports = &viewport;
-	viewportState.scissorCount = 1;
-	viewportState.pScissors = &scissor;
-	
-	VkPipelineRasterizationStateCreateInfo rasterizationState = {};
-	rasterizationState.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterizationState.depthClampEnable = VK_FALSE;
-	rasterizationState.rasterizerDiscardEnable = VK_FALSE;
-	rasterizationState.polygonMode = VK_POLYGON_MODE_FILL; //VK_POLYGON_MODE_LINE
-	rasterizationState.cullMode = VK_CULL_MODE_BACK_BIT;
-	rasterizationState.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-	rasterizationState.lineWidth = 1.f;
-	rasterizationState.depthBiasEnable = VK_FALSE;
-
-	VkPipelineMultisampleStateCreateInfo multisampling = {};
-	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisampling.sampleShadingEnable = VK_FALSE;
-	multisampling.rasterizationSamples = VKImage::msaaSamples;
-	multisampling.sampleShadingEnable = VK_TRUE;
-	multisampling.minSampleShading = .2f;
-
-	VkPipelineDepthStencilStateCreateInfo depthStencil = {};
-	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-	depthStencil.depthTestEnable = VK_TRUE;
-	depthStencil.depthWriteEnable = VK_TRUE;
-	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
-	depthStencil.depthBoundsTestEnable = VK_FALSE;
-	depthStencil.minDepthBounds = 0.0f;
-	depthStencil.maxDepthBounds = 1.0f;
-	depthStencil.stencilTestEnable = VK_FALSE;
-	depthStencil.front = {};
-	depthStencil.back = {};
-
-	VkPipelineColorBlendAttachmentState blendAttachment = {};
-	blendAttachment.blendEnable = VK_FALSE;
-	blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-	blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-	blendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-	blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-	blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-	blendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-	blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-
-	VkPipelineColorBlendStateCreateInfo blendState = {};
-	blendState.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	blendState.logicOpEnable = VK_FALSE;
-	blendState.logicOp = VK_LOGIC_OP_COPY;
-	blendState.attachmentCount = 1;
-	blendState.pAttachments = &blendAttachment;
-	blendState.blendConstants[0] = VK_BLEND_FACTOR_ZERO;
-	blendState.blendConstants[1] = VK_BLEND_FACTOR_ZERO;
-	blendState.blendConstants[2] = VK_BLEND_FACTOR_ZERO;
-	blendState.blendConstants[3] = VK_BLEND_FACTOR_ZERO;
-
-	/*VkDynamicState dynamicStates[] = {
-		VK_DYNAMIC_STATE_VIEWPORT,
-		VK_DYNAMIC_STATE_LINE_WIDTH
-	};*/
-
-	VkPipelineDynamicStateCreateInfo dynamicState = {};
-	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	//dynamicState.dynamicStateCount = 2;
-	//dynamicState.pDynamicStates = dynamicStates;
-
-	VkGraphicsPipelineCreateInfo info = {};
-	info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-
-	info.stageCount = 2;
-	info.pStages = shaders;
-
-	info.pVertexInputState = &vertexInputState;
-	info.pInputAssemblyState = &inputAssemblyState;
-	info.pTessellationState = nullptr;
-	info.pViewportState = &viewportState;
-	info.pRasterizationState = &rasterizationState;
-	info.pMultisampleState = &multisampling;
-	info.pDepthStencilState = nullptr;
-	info.pColorBlendState = &blendState;
-	info.pDepthStencilState = &depthStencil;
-
-	info.layout = pipelineLayout;
-	info.renderPass = renderPass;
-	info.subpass = 0;
-
-	//info.basePipelineHandle
-	//info.basePipelineIndex
-
-	VULKAN_CHECK_RESULT(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &info, nullptr, &pipeline), "Failed to create graphics pipeline!");
-
-	vkDestroyShaderModule(device, vertexShader, nullptr);
-	vkDestroyShaderModule(device, fragmentShader, nullptr);
+	// only replaces cullPipeline once it was created, a failed reload keeps the old one
+	VkPipeline pipeline;
+	VkResult result = vkCreateComputePipelines(device, pipelineManager.getPipelineCache(), 1, &info, nullptr, &pipeline);
+	vkDestroyShaderModule(device, cullShader, nullptr);
+	VULKAN_CHECK_RESULT(result, "Failed to create compute pipeline!");
+	cullPipeline = pipeline;
 }
\ No newline at end of file
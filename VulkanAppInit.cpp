@@ -1,6 +1,7 @@
 #include "VulkanApp.h"
 
 #include <set>
+#include <algorithm>
 
 bool QueueFamilyIndices::isComplete() {
 	return graphicsFamily.has_value() && presentationFamily.has_value();
@@ -29,6 +30,27 @@ static void framebufferResizeCallback(GLFWwindow* window, int width, int height)
 	app->framebufferResized = true;
 }
 
+static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+	auto app = reinterpret_cast<VulkanApp*>(glfwGetWindowUserPointer(window));
+	if (action != GLFW_PRESS) return;
+
+	if (key == GLFW_KEY_P) {
+		app->toggleFramePacingProfile();
+	}
+	else if (key == GLFW_KEY_M) {
+		app->cycleQualityTier();
+	}
+	else if (key == GLFW_KEY_R) {
+		app->toggleDynamicResolution();
+	}
+	else if (key == GLFW_KEY_Z) {
+		app->toggleDepthPrepass();
+	}
+	else if (key == GLFW_KEY_L) {
+		app->cycleLightCount();
+	}
+}
+
 void VulkanApp::initWindow() {
 	glfwInit();
 
@@ -37,6 +59,7 @@ void VulkanApp::initWindow() {
 	window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", nullptr, nullptr);
 	glfwSetWindowUserPointer(window, this);
 	glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+	glfwSetKeyCallback(window, keyCallback);
 }
 
 std::vector<const char*> VulkanApp::getRequiredExtensions() {
@@ -203,6 +226,26 @@ bool VulkanApp::checkDeviceExtensionSupport(VkPhysicalDevice device) {
 	return requiredExtensions.empty();
 }
 
+std::vector<const char*> VulkanApp::getEnabledDeviceExtensions() {
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+	std::vector<const char*> extensions(deviceExtensions.begin(), deviceExtensions.end());
+	for (const char* optionalExtension : optionalDeviceExtensions) {
+		for (const auto& extension : availableExtensions) {
+			if (strcmp(extension.extensionName, optionalExtension) == 0) {
+				extensions.push_back(optionalExtension);
+				break;
+			}
+		}
+	}
+
+	return extensions;
+}
+
 bool VulkanApp::isDeviceSuitable(VkPhysicalDevice physicalDevice) {
 	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 	bool extensionsSupported = checkDeviceExtensionSupport(physicalDevice);
@@ -210,7 +253,24 @@ bool VulkanApp::isDeviceSuitable(VkPhysicalDevice physicalDevice) {
 	VkPhysicalDeviceFeatures supportedFeatures;
 	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
 
-	return indices.isComplete() && extensionsSupported && supportedFeatures.samplerAnisotropy;
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {};
+	timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	timelineFeatures.pNext = &indexingFeatures;
+
+	VkPhysicalDeviceFeatures2 features2 = {};
+	features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features2.pNext = &timelineFeatures;
+	if (extensionsSupported) {
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+	}
+
+	return indices.isComplete() && extensionsSupported && supportedFeatures.samplerAnisotropy && timelineFeatures.timelineSemaphore
+		&& supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance
+		&& indexingFeatures.runtimeDescriptorArray && indexingFeatures.descriptorBindingPartiallyBound
+		&& indexingFeatures.descriptorBindingSampledImageUpdateAfterBind && indexingFeatures.shaderSampledImageArrayNonUniformIndexing;
 }
 
 void VulkanApp::getPhysicalDevice() {
@@ -247,15 +307,38 @@ void VulkanApp::getLogicalDevice() {
 	//vkGetPhysicalDeviceFeatures(physicalDevice, &features);
 	features.samplerAnisotropy = VK_TRUE;
 	features.sampleRateShading = VK_TRUE;
+	features.multiDrawIndirect = VK_TRUE;
+	features.drawIndirectFirstInstance = VK_TRUE;
+
+	// optional, only used to report shaded fragments per pixel
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+	features.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+	pipelineStatisticsSupported = supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
+
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {};
+	timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	timelineFeatures.timelineSemaphore = VK_TRUE;
+
+	// the bindless texture table
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+	indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+	indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	timelineFeatures.pNext = &indexingFeatures;
 
 	VkDeviceCreateInfo info = {};
 	info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	info.pNext = &timelineFeatures;
 
 	info.queueCreateInfoCount = (uint32_t)queueInfos.size();
 	info.pQueueCreateInfos = queueInfos.data();
 
-	info.enabledExtensionCount = (uint32_t)deviceExtensions.size();
-	info.ppEnabledExtensionNames = deviceExtensions.data();
+	std::vector<const char*> extensions = getEnabledDeviceExtensions();
+	info.enabledExtensionCount = (uint32_t)extensions.size();
+	info.ppEnabledExtensionNames = extensions.data();
 
 	info.pEnabledFeatures = &features;
 
@@ -263,4 +346,23 @@ void VulkanApp::getLogicalDevice() {
 
 	vkGetDeviceQueue(device, queueFamilyIndices.graphicsFamily.value(), 0, &graphicsQueue);
 	vkGetDeviceQueue(device, queueFamilyIndices.presentationFamily.value(), 0, &presentationQueue);
+
+	drawIndirectCountSupported = std::find_if(extensions.begin(), extensions.end(), [](const char* extension) {
+		return strcmp(extension, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) == 0;
+	}) != extensions.end();
+	if (drawIndirectCountSupported) {
+		cmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR");
+		drawIndirectCountSupported = cmdDrawIndexedIndirectCount != nullptr;
+	}
+
+	// without timestamps the resolution controller has nothing to go on and rendering stays at full resolution
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	timestampPeriod = properties.limits.timestampPeriod;
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+	timestampsSupported = queueFamilies[queueFamilyIndices.graphicsFamily.value()].timestampValidBits > 0;
 }
\ No newline at end of file
@@ -26,8 +26,6 @@ inline void VULKAN_CHECK_RESULT(VkResult result, const char *message)
 const int WIDTH = 800;
 const int HEIGHT = 600;
 
-const int MAX_FRAMES_IN_FLIGHT = 2;
-
 struct QueueFamilyIndices {
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentationFamily;
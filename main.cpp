@@ -1,8 +1,40 @@
 #include "VulkanApp.h"
 
-int main() {
+#include <cstring>
+
+int main(int argc, char** argv) {
 	VulkanApp app;
 
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--latency") == 0) {
+			app.setFramePacingProfile(FramePacingProfile::Latency);
+		}
+		else if (strcmp(argv[i], "--throughput") == 0) {
+			app.setFramePacingProfile(FramePacingProfile::Throughput);
+		}
+		else if (strcmp(argv[i], "--quality") == 0 && i + 1 < argc) {
+			QualityTier tier;
+			if (VKQuality::parseTier(argv[++i], &tier)) {
+				app.setQualityTier(tier);
+			}
+		}
+		else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+			app.setScenePath(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--instances") == 0 && i + 1 < argc) {
+			app.setInstanceCount(static_cast<uint32_t>(atoi(argv[++i])));
+		}
+		else if (strcmp(argv[i], "--prepass") == 0) {
+			app.setDepthPrepass(true);
+		}
+		else if (strcmp(argv[i], "--target-ms") == 0 && i + 1 < argc) {
+			app.setTargetFrameTime(static_cast<float>(atof(argv[++i])));
+		}
+		else if (strcmp(argv[i], "--lights") == 0 && i + 1 < argc) {
+			app.setLightCount(static_cast<uint32_t>(atoi(argv[++i])));
+		}
+	}
+
 	try {
 		app.run();
 	}
@@ -0,0 +1,77 @@
+#include "../VKAssetArchive.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+
+// Packs loose assets into the archive the renderer opens at startup:
+//   pack_assets [output] [file or directory]...
+// Without arguments it packs models, textures, shaders and scenes into assets.pack. Run it from the
+// directory the renderer runs in, entries are named by their path relative to it.
+
+static void addFile(const std::filesystem::path& file, std::vector<VKAssetArchive::Source>& sources) {
+	std::ifstream in(file, std::ios::binary | std::ios::ate);
+	if (!in.is_open()) {
+		throw std::runtime_error("Failed to open " + file.string() + "!");
+	}
+
+	VKAssetArchive::Source source;
+	source.name = file.lexically_normal().generic_string();
+	source.data.resize(static_cast<size_t>(in.tellg()));
+	in.seekg(0);
+	in.read(source.data.data(), source.data.size());
+	sources.push_back(std::move(source));
+}
+
+int main(int argc, char** argv) {
+	std::string output = argc > 1 ? argv[1] : "assets.pack";
+	std::vector<std::string> inputs(argv + std::min(argc, 2), argv + argc);
+	if (inputs.empty()) {
+		inputs = { "models", "textures", "shaders", "scenes" };
+	}
+
+	try {
+		std::vector<VKAssetArchive::Source> sources;
+		for (const std::string& input : inputs) {
+			if (!std::filesystem::is_directory(input)) {
+				addFile(input, sources);
+				continue;
+			}
+
+			// sorted, so the same inputs always give the same archive
+			std::vector<std::filesystem::path> files;
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(input)) {
+				if (entry.is_regular_file()) {
+					files.push_back(entry.path());
+				}
+			}
+			std::sort(files.begin(), files.end());
+			for (const std::filesystem::path& file : files) {
+				addFile(file, sources);
+			}
+		}
+
+		VKAssetArchive::write(output, sources);
+
+		VKAssetArchive archive;
+		archive.tryOpen(output);
+		size_t sourceBytes = 0;
+		for (const VKAssetArchive::Source& source : sources) {
+			sourceBytes += source.data.size();
+		}
+		std::cout << "Packed " << sources.size() << " assets, " << sourceBytes / 1024 << " KB into "
+			<< std::filesystem::file_size(output) / 1024 << " KB " << output << std::endl;
+		for (const VKAssetArchive::Entry& entry : archive.getEntries()) {
+			std::cout << "  " << archive.getName(entry) << ": " << entry.size << " -> " << entry.storedSize
+				<< (entry.compression == VKAssetArchive::Compression::LZ4 ? " lz4" : "") << std::endl;
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
\ No newline at end of file